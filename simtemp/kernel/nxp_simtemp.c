@@ -48,6 +48,15 @@ static struct platform_driver nxp_simtemp_driver=
     },
 };
 
+//-----------Module Parameters and Instances --------------------
+//Number of virtual devices created when the module is loaded: nxp_simtemp (/dev/simtemp), nxp_simtemp.1 (/dev/simtemp1), ...
+static unsigned int nr_devices = 1;
+module_param(nr_devices, uint, 0444);
+MODULE_PARM_DESC(nr_devices, "Number of virtual simtemp instances (1..16)");
+
+static DEFINE_IDA(simtemp_ida);				//Index of each probed instance (virtual or DT)
+static DEFINE_PER_CPU(u64, simtemp_last_fire_ns);	//Last producer callback on each CPU (coalescing metric)
+
 // // //---------File Operations Table: Functions for Driver Map-----------------
 
 //----------------------- Files Prototypes------------------------------
@@ -64,6 +73,8 @@ static const struct file_operations nxp_simtemp_fops =
     .release	=nxp_simtemp_release,	//Pointer to the function performed when User Space calls to close(fd). 
     .read	=nxp_simtemp_read,	//Pointer to the function performed when User Space calls to read(fd, ...)
     .poll	=nxp_simtemp_poll,	//Pointer to the function performed when User Space calls to poll() or epoll().
+    .unlocked_ioctl =nxp_simtemp_ioctl, //Pointer to the function performed when User Space calls to ioctl(fd, SIMTEMP_IOC_*, ...)
+    .compat_ioctl   =compat_ptr_ioctl,  //32-bit User Space on 64-bit Kernel: same commands, pointer argument converted
 
 };
 
@@ -72,11 +83,10 @@ static const struct file_operations nxp_simtemp_fops =
 //---------------Timer Callback (Data Generator) Producer------------------------------------------
 // Telemetry System
 //Timer Intializer function
-// High Precision 'hrtimer' configutration.
+// High Precision 'hrtimer' configutration. The timer is only armed by simtemp_producer_update().
 static void simtemp_timer_setup(struct nxp_simtemp_dev *dev) // For nxp_simtemp_probe(). Here 'dev' pointer is created.
 {
-    //Period is defined by default (100ms)
-    dev->period_ns = ms_to_ktime(dev->sampling_ms);
+    //Period (100ms by default) is taken from the Configuration Snapshot when the timer is armed.
 
     //Timer is initialized.
     // CLOCK_MONOTONIC: Clock from [kernel] independently from changes.
@@ -86,12 +96,282 @@ static void simtemp_timer_setup(struct nxp_simtemp_dev *dev) // For nxp_simtemp_
     //Assigns pointer to function every time timer is triggered
     //Timer start
     dev->timer.function = simtemp_timer_callback; //Data producer where the sample is generated and Ring Buffer is full. 
+}
 
-    //Kernel starts to perform Timer in time interval defined
-    //Timer starts
-    hrtimer_start(&dev->timer, dev->period_ns, HRTIMER_MODE_REL);
+//Timer Arm: Programs the first expiry of the producer.
+//RELATIVE: one period from now. ALIGNED: next multiple of the period on CLOCK_MONOTONIC, so every instance
+//with the same period expires at the same instants and the kernel serves them in one wakeup.
+//The slack lets the hrtimer core delay the expiry up to slack_ns to coalesce it with other timers.
+//Called with dev->ctl_lock held, so the snapshot can not be replaced meanwhile.
+static void simtemp_timer_arm(struct nxp_simtemp_dev *dev)
+{
+    const struct simtemp_config *cfg = rcu_dereference_protected(dev->cfg, lockdep_is_held(&dev->ctl_lock));
+    u64 period = ktime_to_ns(cfg->period_ns);
+    u64 next;
 
-    
+    if (cfg->timer_mode == SIMTEMP_TIMER_ALIGNED)
+    {
+	next = (div64_u64(ktime_get_ns(), period) + 1) * period;
+	simtemp_timer_start(dev, ns_to_ktime(next), cfg->slack_ns, HRTIMER_MODE_ABS);
+    }
+    else
+    {
+	simtemp_timer_start(dev, cfg->period_ns, cfg->slack_ns, HRTIMER_MODE_REL);
+    }
+}
+
+//---------------CPU Affinity of the Producer------------------------------------------
+//A pinned hrtimer stays in the clock base of the CPU that armed it, and hrtimer_forward() from the callback
+//keeps it there. So the producer is moved to a CPU by arming it from that CPU with HRTIMER_MODE_*_PINNED.
+//If the CPU goes offline, the hrtimer core migrates the timer and 'stats' shows where it runs now.
+
+//Arguments of the IPI that arms the timer on the target CPU
+struct simtemp_timer_req
+{
+    struct nxp_simtemp_dev     *dev;
+    ktime_t                     expires;
+    u64                         slack_ns;
+    enum hrtimer_mode           mode;
+};
+
+//CPU Affinity (Pick): Online CPU of 'producer_cpus' that runs this instance, -1 when not pinned.
+//Instances sharing the same mask are spread over it by their index (simtemp0 on the 1st CPU, simtemp1 on the 2nd, ...).
+static int simtemp_producer_pick_cpu(struct nxp_simtemp_dev *dev)
+{
+    unsigned int online = 0;
+    unsigned int nth;
+    int cpu;
+
+    for_each_cpu_and(cpu, &dev->producer_cpus, cpu_online_mask)
+    {
+	online++;
+    }
+
+    if (!online)
+    {
+	return -1;
+    }
+
+    nth = dev->index % online;
+    for_each_cpu_and(cpu, &dev->producer_cpus, cpu_online_mask)
+    {
+	if (!nth--)
+	{
+	    break;
+	}
+    }
+
+    return cpu;
+}
+
+static void simtemp_timer_start_local(void *data)
+{
+    struct simtemp_timer_req *req = data;
+
+    hrtimer_start_range_ns(&req->dev->timer, req->expires, req->slack_ns, req->mode);
+}
+
+//CPU Affinity (Start): hrtimer_start_range_ns() on the CPU selected by 'producer_cpus'.
+//Called with dev->ctl_lock held (process context): smp_call_function_single() waits for the remote CPU.
+static void simtemp_timer_start(struct nxp_simtemp_dev *dev, ktime_t expires, u64 slack_ns, enum hrtimer_mode mode)
+{
+    struct simtemp_timer_req req = { .dev = dev, .expires = expires, .slack_ns = slack_ns, .mode = mode };
+    int cpu = simtemp_producer_pick_cpu(dev);
+
+    if (cpu >= 0)
+    {
+	req.mode |= HRTIMER_MODE_PINNED;
+	if (!smp_call_function_single(cpu, simtemp_timer_start_local, &req, 1))
+	{
+	    return;
+	}
+
+	//The CPU went offline meanwhile: armed here, not pinned
+	req.mode &= ~HRTIMER_MODE_PINNED;
+    }
+
+    simtemp_timer_start_local(&req);
+}
+
+//CPU Affinity (Migrate): Moves a running producer to the CPU of the new mask.
+//The pending expiry is kept (absolute), so the period grid is not shifted and no sample is skipped or doubled.
+//hrtimer_cancel() waits for a running callback, which has already forwarded the expiry.
+static void simtemp_producer_migrate(struct nxp_simtemp_dev *dev)
+{
+    ktime_t soft;
+    u64 slack_ns;
+
+    if (!dev->running)
+    {
+	return;
+    }
+
+    hrtimer_cancel(&dev->timer);
+
+    soft = hrtimer_get_softexpires(&dev->timer);
+    slack_ns = ktime_to_ns(ktime_sub(hrtimer_get_expires(&dev->timer), soft));
+
+    simtemp_timer_start(dev, soft, slack_ns, HRTIMER_MODE_ABS);
+}
+
+//CPU Affinity (DT): 'producer-cpus' = <cpu ...>. CPUs that do not exist are ignored.
+static void simtemp_producer_parse_dt(struct nxp_simtemp_dev *dev, struct device *pdev_dev)
+{
+    int n = of_property_count_u32_elems(pdev_dev->of_node, "producer-cpus");
+    u32 cpu;
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+	if (!of_property_read_u32_index(pdev_dev->of_node, "producer-cpus", i, &cpu) && cpu < nr_cpu_ids)
+	{
+	    cpumask_set_cpu(cpu, &dev->producer_cpus);
+	}
+    }
+
+    if (n > 0)
+    {
+	dev_info(pdev_dev, "producer pinned to CPUs %*pbl\n", cpumask_pr_args(&dev->producer_cpus));
+    }
+}
+
+//Timer Forward: Programs the next expiry from the snapshot seen by this callback.
+//A new period, slack or mode is therefore applied at the next expiry, without cancelling the timer:
+//no gap in the stream and no sample produced twice.
+//RELATIVE: whole periods are added to the previous expiry (drift-free).
+//ALIGNED: next multiple of the period after 'now', so a new period is phase-locked again at once.
+static void simtemp_timer_forward(struct hrtimer *timer, const struct simtemp_config *cfg, ktime_t now)
+{
+    u64 period = ktime_to_ns(cfg->period_ns);
+    u64 next;
+
+    if (cfg->timer_mode == SIMTEMP_TIMER_ALIGNED)
+    {
+	next = (div64_u64(ktime_to_ns(now), period) + 1) * period;
+	hrtimer_set_expires_range_ns(timer, ns_to_ktime(next), cfg->slack_ns);
+    }
+    else
+    {
+	hrtimer_forward(timer, now, cfg->period_ns);
+	hrtimer_set_expires_range_ns(timer, hrtimer_get_softexpires(timer), cfg->slack_ns);
+    }
+}
+
+//Configuration Snapshot (Edit): Private copy of the published snapshot that the caller can modify.
+//Called with dev->ctl_lock held: writers are serialized, the producer is never blocked.
+static struct simtemp_config *simtemp_config_edit(struct nxp_simtemp_dev *dev)
+{
+    const struct simtemp_config *cur = rcu_dereference_protected(dev->cfg, lockdep_is_held(&dev->ctl_lock));
+
+    return kmemdup(cur, sizeof(*cur), GFP_KERNEL);
+}
+
+//Configuration Snapshot (Publish): The producer sees either the old or the new snapshot, never a mix.
+//The old one is freed after every callback that could be using it has finished (kfree_rcu).
+static void simtemp_config_publish(struct nxp_simtemp_dev *dev, struct simtemp_config *cfg)
+{
+    struct simtemp_config *old = rcu_dereference_protected(dev->cfg, lockdep_is_held(&dev->ctl_lock));
+
+    rcu_assign_pointer(dev->cfg, cfg);
+    dev->cfg_updates++;
+
+    kfree_rcu(old, rcu);
+}
+
+//Configuration Snapshot (devm action): frees the last published snapshot when the device goes away.
+//The producer was stopped by nxp_simtemp_remove() before, so nobody can be reading it.
+static void simtemp_config_free(void *data)
+{
+    struct nxp_simtemp_dev *dev = data;
+
+    kfree(rcu_dereference_protected(dev->cfg, 1));
+}
+
+//Device Lifetime: the Global Structure is not devm-managed because open files outlive remove() (unbind).
+//probe() holds one reference (dropped by a devm action after remove()) and every open file holds another one.
+static void simtemp_dev_release(struct kref *ref)
+{
+    struct nxp_simtemp_dev *dev = container_of(ref, struct nxp_simtemp_dev, ref);
+
+    simtemp_history_free(dev);
+    simtemp_config_free(dev);
+    kfree(dev);
+}
+
+static void simtemp_dev_put(void *data)
+{
+    struct nxp_simtemp_dev *dev = data;
+
+    kref_put(&dev->ref, simtemp_dev_release);
+}
+
+//remove(): the producer is stopped for good and every sleeping reader is woken. Open files stay attached to the
+//structure (their reference keeps it alive) but read() returns -ENODEV and poll() reports EPOLLHUP from now on.
+static void simtemp_dev_detach(struct nxp_simtemp_dev *dev)
+{
+    struct simtemp_file *ctx;
+    unsigned long flags;
+
+    mutex_lock(&dev->ctl_lock);
+    WRITE_ONCE(dev->dead, true);
+    if (dev->running)
+    {
+	hrtimer_cancel(&dev->timer);
+	dev->running = false;
+	pm_runtime_put(dev->mdev.parent);
+    }
+    mutex_unlock(&dev->ctl_lock);
+
+    spin_lock_irqsave(&dev->lock, flags);
+    list_for_each_entry(ctx, &dev->files, node)
+    {
+	wake_up_interruptible_all(&ctx->wq);
+    }
+    spin_unlock_irqrestore(&dev->lock, flags);
+
+    wake_up_interruptible_all(&dev->wq);
+}
+
+//Lazy Producer (Start/Stop): The hrtimer runs only while somebody needs samples:
+//the first open() starts it, the last release() stops it, unless 'always_on' keeps it running.
+//While running, the producer holds a Runtime PM reference so the device can be suspended when idle.
+//Called with dev->ctl_lock held (process context): hrtimer_cancel() may wait for the callback.
+//Returns the error of the Runtime PM resume when the producer could not be started (stopping never fails).
+static int simtemp_producer_update(struct nxp_simtemp_dev *dev)
+{
+    struct device *pdev_dev = dev->mdev.parent;
+    bool wanted = dev->users > 0 || dev->always_on;
+    int ret;
+
+    //After remove() the producer stays stopped: the last close() must not touch the unbound platform device
+    if (dev->dead || wanted == dev->running)
+    {
+	return 0;
+    }
+
+    if (wanted)
+    {
+	ret = pm_runtime_resume_and_get(pdev_dev);
+	if (ret < 0)
+	{
+	    dev_err(pdev_dev, "Runtime PM resume failed (%d), producer not started\n", ret);
+	    return ret;
+	}
+
+	//Kernel starts to perform Timer in time interval defined
+	simtemp_timer_arm(dev);
+	dev->running = true;
+    }
+    else
+    {
+	//Stops the producer: waits for a running callback to finish
+	hrtimer_cancel(&dev->timer);
+	dev->running = false;
+
+	pm_runtime_put(pdev_dev);
+    }
+
+    return 0;
 }
 
 
@@ -108,6 +388,9 @@ static void simtemp_buffer_init(struct simtemp_ring_buffer *rb)
     //Initializes Writing Pointer (Counter)
     rb->count = 0;
 
+    //Initializes Sequence of the next sample (used by the cursors of filtered files)
+    rb->seq = 0;
+
     //Maybe memset to clean buffer.
 }
 
@@ -132,7 +415,8 @@ static void simtemp_buffer_push(struct nxp_simtemp_dev *dev, const struct simtem
     {
 	dev->rb.tail = (dev->rb.tail + 1) % RING_BUFFER_SIZE;
 	dev->rb.count--;
-	printk(KERN_WARNING "NXP SimTemp: Buffer overflow, discarded sample.\n");
+	dev->overflows++;
+	printk_ratelimited(KERN_WARNING "NXP SimTemp: Buffer overflow, discarded sample.\n");  //Rate limited: without readers every sample overflows
 
 
     }
@@ -141,6 +425,7 @@ static void simtemp_buffer_push(struct nxp_simtemp_dev *dev, const struct simtem
     dev->rb.buffer[dev->rb.head] = *sample;		    //sample value is copied to buffer array in actual position of writing pointer.
     dev->rb.head = (dev->rb.head + 1) % RING_BUFFER_SIZE;   //if head reaches to end of Ring Buffer, module makes the pointer returns to 0 index.
     dev->rb.count++;					    //counter is incremented
+    dev->rb.seq++;					    //Sequence of the next sample. Never wraps, so cursors can detect overwritten samples
 }
 
 //Logic Prototypes (SimTemp Function-Pop): Read and remove the oldest sample (Called by read() function)
@@ -165,409 +450,1678 @@ static bool simtemp_buffer_pop(struct nxp_simtemp_dev *dev, struct simtemp_sampl
     return true; //If reading was successful
 }
 
-//---------------Timer Callback (Data Generator) Producer------------------------------------------
-//------------------Data Producer [Kernel] periodic and precise ------------------ 
-// Activated each time when 'hrtimer' is triggered each 'sampling_ms'
-// Interruption context (Softirq) soft interruption
-enum hrtimer_restart simtemp_timer_callback(struct hrtimer *timer) //[kernel]
-{
-    // Obtains the memory address of 'nxp_simtemp_dev' through 'struct hrtimer *timer'
-    struct nxp_simtemp_dev *dev = container_of(timer, struct nxp_simtemp_dev, timer); //Macro [kernel] to navigates in memory, obtains the memory address
-    struct simtemp_sample   sample;	// access to timestamp_ns, temp_mC and flags
-    unsigned long flags;		// variable flag
-    s32 current_temp;
-    u32 random_offset;
+// ---------------------- (History Window)  ---------------------------------------
 
-    //Data Generation
+//Logic Producer (SimTemp Function-History Push): Keeps every sample in the history window (dev->lock held).
+//Unlike the ring, nothing consumes the window: the oldest sample is simply overwritten.
+static void simtemp_history_push(struct nxp_simtemp_dev *dev, const struct simtemp_sample *sample)
+{
+    if (dev->hist.len)
+    {
+	dev->hist.buf[dev->hist.seq & (dev->hist.len - 1)] = *sample;
+    }
+    dev->hist.seq++;
+}
 
-    get_random_bytes(&random_offset, sizeof(random_offset));
-    current_temp = 45000 + (random_offset % 10000 ) - 5000;
+//Logic (SimTemp Function-History Resize): Replaces the window by one of 'len' samples (rounded up to a power of two,
+//0 disables it). The newest samples are kept in their sequence slots and 'start' marks the first of them: the slots of
+//a grown window before it were never written. Allocation and free happen outside the lock; the copy is done with the producer held.
+static int simtemp_history_resize(struct nxp_simtemp_dev *dev, u32 len)
+{
+    struct simtemp_sample *buf = NULL, *old;
+    unsigned long flags;
+    u64 keep, n;
 
-    sample.timestamp_ns = ktime_get_real_ns();	     //Generates a timestamp in nanoseconds
-    sample.temp_mC = current_temp;   //jiffies is a [kernel] counter 
-    sample.flags = SAMPLE_AVAILABLE;		//Sets bit 0 to indicate a sample available for Consumer (read()).	    
+    if (len)
+    {
+	len = roundup_pow_of_two(len);
+	buf = kvcalloc(len, sizeof(*buf), GFP_KERNEL);
+	if (!buf)
+	{
+	    return -ENOMEM;
+	}
+    }
 
-    //---Start critical section--
-    //Ensuring atomicity (critical)
-    spin_lock_irqsave(&dev->lock, flags);   //Adquires 'Spinlock' and disable interruptions in CPU
+    //--------Critical Section: the producer writes the window---------
+    spin_lock_irqsave(&dev->lock, flags);
 
-    if(current_temp > dev->threshold_mC)
+    keep = min_t(u64, len, dev->hist.seq - simtemp_history_oldest(dev));    //Only valid samples are carried over
+    for (n = dev->hist.seq - keep; n < dev->hist.seq; n++)
     {
-	sample.flags |= TRESHOLD_CROSSED;
-	dev->alerts_count++;
-
+	buf[n & (len - 1)] = dev->hist.buf[n & (dev->hist.len - 1)];
     }
 
+    old = dev->hist.buf;
+    dev->hist.buf = buf;
+    dev->hist.len = len;
+    dev->hist.start = dev->hist.seq - keep;
 
+    spin_unlock_irqrestore(&dev->lock, flags);
+    //-------------------End of critical section--------------
 
-    //Data Writing [Logic]. Writes the sample in Ring Buffer through overwritting
-    simtemp_buffer_push(dev, &sample);	//If buffer is full moving the tail if necessary
-
-     dev->updates_count++;	 //Counter for Diagnostic Function
+    kvfree(old);    //Concurrent resizes are safe: each one frees the window it replaced
 
-    //Liberates 'spin_unlock()' adquired by 'simtemp_call_back()' or 'read()' rutines.
-    spin_unlock_irqrestore(&dev->lock, flags); //Restores the interruptions states.
+    return 0;
+}
 
-    //[Kernel] Wake-up the processes (read/poll) that are slept in Wait Queue (wq)
-    wake_up_interruptible(&dev->wq); //Notifies the existence of new data to User Space processes
-   
-    
-    //--End critical section---
+//Logic (SimTemp Function-History Oldest): First valid sequence of the window (dev->lock held). The window holds the last
+//'len' sequences once the producer has written them all; until then only the ones from 'start' on (kept by a resize or pushed after it).
+static u64 simtemp_history_oldest(const struct nxp_simtemp_dev *dev)
+{
+    return max(dev->hist.start, dev->hist.seq - min_t(u64, dev->hist.seq, dev->hist.len));
+}
 
+//Logic Consumer (SimTemp Function-History Query): SIMTEMP_IOC_GET_HISTORY. Copies the newest 'count' samples or the ones
+//from sequence 'since_seq' on, oldest first, without consuming them. The range is fixed when the query starts and copied in batches
+//of SIMTEMP_READ_BATCH with copy_to_user() outside the spinlock (as read()); samples overwritten meanwhile are counted in 'lost'.
+static long simtemp_history_query(struct nxp_simtemp_dev *dev, struct simtemp_history __user *uarg)
+{
+    struct simtemp_sample batch[SIMTEMP_READ_BATCH];
+    struct simtemp_sample __user *ubuf;
+    struct simtemp_history q;
+    unsigned long flags;
+    u64 seq, end, oldest;
+    u32 copied = 0;
+    u32 n, i;
+
+    if (copy_from_user(&q, uarg, sizeof(q)))
+    {
+	return -EFAULT;
+    }
+    if (q.mode != SIMTEMP_HISTORY_LAST && q.mode != SIMTEMP_HISTORY_SINCE)
+    {
+	return -EINVAL;
+    }
+    ubuf = u64_to_user_ptr(q.samples);
 
-    //Timer reassemble.
-    //Compensate latency (callback time) and programes the next trigger after (dev->period_ns)
-    hrtimer_forward_now(timer,dev->period_ns); //Mantains the periodicity
+    //Range of the query: [seq, end)
+    spin_lock_irqsave(&dev->lock, flags);
+    end = dev->hist.seq;
+    oldest = simtemp_history_oldest(dev);
+    q.available = end - oldest;
+    if (q.mode == SIMTEMP_HISTORY_LAST)
+    {
+	seq = end - min_t(u64, q.count, end - oldest);
+    }
+    else
+    {
+	seq = min(q.since_seq, end);          //A sequence not produced yet: up to date
+    }
+    spin_unlock_irqrestore(&dev->lock, flags);
 
-    return HRTIMER_RESTART; //Data required by 'hrtimer' API [kernel] to timer comes back 
-}
+    //SINCE from a sequence already dropped: the gap is reported as lost
+    q.lost = seq < oldest ? min_t(u64, oldest - seq, U32_MAX) : 0;
+    seq = max(seq, oldest);
+    while (copied < q.count && seq < end)
+    {
+	spin_lock_irqsave(&dev->lock, flags);
 
+	//The producer (or a resize) dropped samples of the range while the previous batch was copied
+	oldest = simtemp_history_oldest(dev);
+	if (seq < oldest)
+	{
+	    q.lost += min(oldest, end) - seq;
+	    seq = min(oldest, end);
+	}
 
+	n = min_t(u64, min_t(u64, end - seq, q.count - copied), SIMTEMP_READ_BATCH);
+	for (i = 0; i < n; i++)
+	{
+	    batch[i] = dev->hist.buf[(seq + i) & (dev->hist.len - 1)];
+	}
 
-//------------------ Platform Device	 Functions     -----------------------------------/
-// ----------- Platform Device: File Interface Functions -------------
+	spin_unlock_irqrestore(&dev->lock, flags);
 
-//------nxp_simtemp_open() Function [Logic]-----------
-//'struct inode *inode' (/dev/simtemp) 
-//'struct file *file' are parameters [kernel] for Active Sesion Application-Driver. Equivalent to File Descriptor (fd) from Kernel.
-//"file" represents the specific instance during the opening
-static int nxp_simtemp_open(struct inode *inode, struct file *file)	    //Function [Logic] performed once when User Space opens the file /dev/simtemp
-{
-    //Recover the pointer to Global State struct(nxp_simtemp_dev). Useful for the following functions.
-    //'container_of' [kernel] obtains the pointer (file->private_data) from 'nxp_simtemp_dev' through 'mdev'
-    // Here is created '*nxp_dev' pointer
-    struct nxp_simtemp_dev *nxp_dev = container_of(file->private_data, struct nxp_simtemp_dev, mdev); 
+	if (!n)
+	{
+	    break;
+	}
+	if (copy_to_user(ubuf + copied, batch, n * sizeof(batch[0])))
+	{
+	    return -EFAULT;
+	}
+	copied += n;
+	seq += n;
+    }
 
-    file->private_data = nxp_dev; //Stores the Driver Pointer in field (private_data) of structure (file).
+    q.count = copied;
+    q.next_seq = seq;
+    if (copy_to_user(uarg, &q, sizeof(q)))
+    {
+	return -EFAULT;
+    }
 
     return 0;
 }
 
-static int nxp_simtemp_release(struct inode *inode, struct file *file)	//Prototype of function performed when user space calls to close() or when the process end.
+static void simtemp_history_free(void *data)
 {
+    struct nxp_simtemp_dev *dev = data;
 
-//Here memory is liberated if specific memory was assignated for this aperture process.
-
-return 0;
+    kvfree(dev->hist.buf);
+    dev->hist.buf = NULL;
 }
 
-// ----------- Platform Device: File Interface Functions -------------
-//---------nxp_simtemp_read() [Logic] Function--------- Consumer function for access to producer (hrtimer and Ring Buffer) performed in Kernel
-// *buf: Pointer(char*) to Destination Buffer for RAM memory of User Space reserves to receive the sensor.
-//char __user: Critical Qualifier of [kernel] to indicates this pointer (char*) does not belongs to Kernel.
-static ssize_t nxp_simtemp_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)      //Prototype of function performed when User Space calls to read().
+
+// ---------------------- (Threshold Levels)  ---------------------------------------
+
+//Logic Producer (SimTemp Function-Levels Update): Evaluates every level with its hysteresis for a new sample.
+//Returns the bitmask of levels exceeded (bit n = level n) and accounts one alert per exceeded level.
+//Called with dev->lock held by the hrtimer callback, with the snapshot it read under RCU.
+static u32 simtemp_levels_update(struct nxp_simtemp_dev *dev, const struct simtemp_config *cfg, s32 temp_mC)
 {
-    //[Logic] Retrieves the pointer 'nxp_dev' from Global Structure from open()
-    struct nxp_simtemp_dev *dev = file->private_data; //Asigns the memrory direction revovered from (file->private_data) to dev variable
-    
-    //Character Device Channel: Access to samples: timestamp_ns, temp_mC and flags.  
-    struct simtemp_sample sample;  //copy the register from Kernel to User Space through Character Device Channel     
-    ssize_t retval = 0;			//    
-    unsigned long flags;	    //Saves interruptions states. Store and Restore the status of the interruptions.
-    
-    //Ring Buffer [Logic] must be large enough
-    if (count < sizeof(sample))
+    u32 mask = 0;
+    u32 i;
+
+    //A new table was published: the hysteresis state restarts and the levels out of use lose their alerts
+    if (dev->levels_gen != cfg->levels_gen)
     {
-	return -EINVAL; //Error -22 Invalid Argument [kernel]: Buffer too small for sample.
+	for (i = 0; i < SIMTEMP_MAX_LEVELS; i++)
+	{
+	    dev->levels[i].active = false;
+	    if (i >= cfg->nr_levels)
+	    {
+		dev->levels[i].alerts = 0;
+	    }
+	}
+	dev->levels_gen = cfg->levels_gen;
     }
 
-
-    while (simtemp_buffer_is_empty(dev))
+    for (i = 0; i < cfg->nr_levels; i++)
     {
-	if(file->f_flags & O_NONBLOCK)
+	struct simtemp_level_state *lvl = &dev->levels[i];
+
+	if (temp_mC > cfg->levels[i].threshold_mC)
 	{
-	    return -EAGAIN; 
+	    lvl->active = true;	    //Level exceeded
+	}
+	else if ((s64)temp_mC <= (s64)cfg->levels[i].threshold_mC - cfg->levels[i].hysteresis_mC)
+	{
+	    lvl->active = false;    //Released below the hysteresis band
 	}
 
-	if (wait_event_interruptible(dev->wq, !simtemp_buffer_is_empty(dev)))
+	if (lvl->active)
 	{
-	    return -ERESTARTSYS;
+	    mask |= BIT(i);
+	    lvl->alerts++;
+	    lvl->alerts_total++;
 	}
     }
 
-    //Atomic extraction. SpinLock is acquired
-    //Interrupts are disabled.
-    //hrtimer is locked to avoid to write in Ring Buffer while read() is reading 
-    //Avoids Race Condition.
-    spin_lock_irqsave(&dev->lock, flags);
-    
-    //Buffer is readed.
-    //Calls to Ring Buffer [Logic] to extract the oldest data.
-    if (simtemp_buffer_pop(dev, &sample))
-    {
-	retval = sizeof(sample);    //Variable adquires the exact data of sample.
+    return mask;
+}
 
-	   if ((sample.flags & TRESHOLD_CROSSED) && dev->alerts_count > 0) {
-		dev->alerts_count--;
+//Logic (SimTemp Function-Levels Pending): Bitmask of levels with alerts not acknowledged yet (POLLPRI source).
+//Called with dev->lock held.
+static u32 simtemp_levels_pending(struct nxp_simtemp_dev *dev)
+{
+    u32 mask = 0;
+    u32 i;
+
+    //Levels out of use have no alerts (cleared by the producer when the table changes)
+    for (i = 0; i < SIMTEMP_MAX_LEVELS; i++)
+    {
+	if (dev->levels[i].alerts)
+	{
+	    mask |= BIT(i);
 	}
     }
-    else
-    {
 
-	retval = -EAGAIN; //Error -11 Try Again. [Kernel] Only if buffer is empty just before the lock.
-
-    }
+    return mask;
+}
 
-    // [Kernel] Liberates SpinLock.
-    // hrtimer returns to normal execution.
-    spin_unlock_irqrestore(&dev->lock, flags);	     
+//Logic Consumer (SimTemp Function-Levels Ack): A sample with alerts was consumed from the shared queue,
+//its levels are acknowledged. Called with dev->lock held by read().
+static void simtemp_levels_ack(struct nxp_simtemp_dev *dev, u32 sample_flags)
+{
+    u32 mask = SIMTEMP_LEVEL_FLAGS(sample_flags);
+    u32 i;
 
-    if (retval > 0)
+    for (i = 0; i < SIMTEMP_MAX_LEVELS; i++)
     {
-	//Buffer Transfer [kernel]; Copies the Sample to Memory Direction of User Space Memory
-	//Only allows to write in the buffer *buf of __user type is ONLY this function. 
-	if (copy_to_user(buf, &sample, sizeof(sample)))
+	if ((mask & BIT(i)) && dev->levels[i].alerts > 0)
+	{
+	    dev->levels[i].alerts--;
+	}
+    }
+}
+
+//Logic Control (SimTemp Function-Levels Apply): Replaces the whole threshold table in one snapshot,
+//so the producer never evaluates a sample against a half updated table.
+//Alert counters of the levels kept in use are preserved, the hysteresis state is re-evaluated by the next sample.
+static int simtemp_levels_apply(struct nxp_simtemp_dev *dev, const struct simtemp_levels *table)
+{
+    struct simtemp_config *cfg;
+    u32 i;
+
+    if (table->count > SIMTEMP_MAX_LEVELS || table->reserved)
+    {
+	return -EINVAL;
+    }
+
+    for (i = 0; i < table->count; i++)
+    {
+	if (table->level[i].reserved)
+	{
+	    return -EINVAL;
+	}
+    }
+
+    mutex_lock(&dev->ctl_lock);
+
+    cfg = simtemp_config_edit(dev);
+    if (!cfg)
+    {
+	mutex_unlock(&dev->ctl_lock);
+	return -ENOMEM;
+    }
+
+    memset(cfg->levels, 0, sizeof(cfg->levels));
+    for (i = 0; i < table->count; i++)
+    {
+	cfg->levels[i].threshold_mC = table->level[i].threshold_mC;
+	cfg->levels[i].hysteresis_mC = table->level[i].hysteresis_mC;
+    }
+    cfg->nr_levels = table->count;
+    cfg->levels_gen++;
+
+    simtemp_config_publish(dev, cfg);
+
+    mutex_unlock(&dev->ctl_lock);
+
+    simtemp_wake_readers(dev);	//POLLPRI of the readers may have changed
+
+    return 0;
+}
+
+//DT (SimTemp Function-Levels Parse): Reads the table from 'threshold-levels-mC' and 'threshold-hysteresis-mC'.
+//Without 'threshold-levels-mC' the table has one level with the legacy 'threshold-mC' value.
+static void simtemp_levels_parse_dt(struct simtemp_config *cfg, struct device *pdev_dev, s32 threshold_mC)
+{
+    u32 thresholds[SIMTEMP_MAX_LEVELS];
+    u32 hysteresis[SIMTEMP_MAX_LEVELS] = { 0 };
+    int n, count;
+    int i;
+
+    n = of_property_read_variable_u32_array(pdev_dev->of_node, "threshold-levels-mC", thresholds, 1, SIMTEMP_MAX_LEVELS);
+    if (n < 0)
+    {
+	cfg->levels[0].threshold_mC = threshold_mC;
+	cfg->nr_levels = 1;
+	return;
+    }
+
+    //Hysteresis is optional (absent: -EINVAL, every entry 0). One entry per level is expected: with a different
+    //length the first min(count, n) entries are used, the missing ones are 0 and the extra ones are ignored.
+    count = of_property_count_u32_elems(pdev_dev->of_node, "threshold-hysteresis-mC");
+    if (count >= 0 && count != n)
+    {
+	dev_warn(pdev_dev, "threshold-hysteresis-mC has %d entries for %d levels, using the first %d\n", count, n, min(count, n));
+    }
+    else if (count < 0 && count != -EINVAL)
+    {
+	dev_warn(pdev_dev, "Invalid threshold-hysteresis-mC (%d), using 0\n", count);
+    }
+
+    if (count > 0 && of_property_read_u32_array(pdev_dev->of_node, "threshold-hysteresis-mC", hysteresis, min(count, n)))
+    {
+	dev_warn(pdev_dev, "threshold-hysteresis-mC could not be read, using 0\n");
+	memset(hysteresis, 0, sizeof(hysteresis));
+    }
+
+    for (i = 0; i < n; i++)
+    {
+	cfg->levels[i].threshold_mC = (s32)thresholds[i];
+	cfg->levels[i].hysteresis_mC = hysteresis[i];
+    }
+    cfg->nr_levels = n;
+
+    dev_info(pdev_dev, "%d threshold levels read from DT\n", n);
+}
+
+// ---------------------- (Per-file Filters)  ---------------------------------------
+
+//Logic Filter (SimTemp Function-Filter Match): Decides if one sample must be delivered to a filtered file.
+//Every enabled condition must pass. Stateless conditions are evaluated first so the stateful ones
+//(delta and decimation) only account for samples that would be delivered.
+static bool simtemp_filter_match(struct simtemp_file *ctx, const struct simtemp_sample *sample)
+{
+    const struct simtemp_filter *f = &ctx->filter;
+
+    if ((f->mode & SIMTEMP_FILTER_ALERT_ONLY) && !(SIMTEMP_LEVEL_FLAGS(sample->flags) & ctx->level_mask))
+    {
+	return false;
+    }
+
+    if ((f->mode & SIMTEMP_FILTER_RANGE) && (sample->temp_mC < f->min_mC || sample->temp_mC > f->max_mC))
+    {
+	return false;
+    }
+
+    if ((f->mode & SIMTEMP_FILTER_DELTA) && ctx->has_last &&
+	abs((s64)sample->temp_mC - ctx->last_mC) <= (s64)f->delta_mC)
+    {
+	return false;
+    }
+
+    if (f->mode & SIMTEMP_FILTER_EVERY_N)
+    {
+	if (ctx->nth++ % f->every_n)
+	{
+	    return false;
+	}
+    }
+
+    //Accepted: this sample becomes the reference for the next delta comparison
+    ctx->last_mC = sample->temp_mC;
+    ctx->has_last = true;
+
+    return true;
+}
+
+//Logic Filter (SimTemp Function-Filter Advance): Moves the cursor of a filtered file over rejected samples
+//and stops on the first accepted one (ctx->ready) without consuming it.
+//Called with dev->lock held from read(), poll() and the producer (to decide who is woken).
+static bool simtemp_filter_advance(struct nxp_simtemp_dev *dev, struct simtemp_file *ctx)
+{
+    u64 oldest = (dev->rb.seq > RING_BUFFER_SIZE) ? dev->rb.seq - RING_BUFFER_SIZE : 0;
+
+    //The producer overwrote samples this file did not evaluate yet: restart at the oldest one in the ring
+    if (ctx->cursor < oldest)
+    {
+	ctx->dropped += oldest - ctx->cursor;
+	ctx->cursor = oldest;
+	ctx->ready = false;
+    }
+
+    while (!ctx->ready && ctx->cursor < dev->rb.seq)
+    {
+	if (simtemp_filter_match(ctx, &dev->rb.buffer[ctx->cursor % RING_BUFFER_SIZE]))
+	{
+	    ctx->ready = true;
+	}
+	else
+	{
+	    ctx->cursor++;
+	}
+    }
+
+    return ctx->ready;
+}
+
+//Logic Filter (SimTemp Function-Own Cursor): Filtered and broadcast files do not consume the shared queue (rb.tail),
+//they read the ring through ctx->cursor and sleep in ctx->wq.
+static bool simtemp_file_own_cursor(const struct simtemp_file *ctx)
+{
+    return ctx->filter.mode || ctx->delivery == SIMTEMP_DELIVERY_BROADCAST;
+}
+
+//Logic Filter (SimTemp Function-File Ready): Wait condition of filtered readers (takes the lock by itself)
+static bool simtemp_file_ready(struct nxp_simtemp_dev *dev, struct simtemp_file *ctx)
+{
+    unsigned long flags;
+    bool ready;
+
+    spin_lock_irqsave(&dev->lock, flags);
+    ready = simtemp_filter_advance(dev, ctx);
+    spin_unlock_irqrestore(&dev->lock, flags);
+
+    return ready || READ_ONCE(dev->dead);	//remove() also ends the wait
+}
+
+//Wakes-up every reader: shared queue (dev->wq) and the per-file queues of filtered/broadcast files.
+//Used by configuration changes (threshold, clear_alert) that can change the poll() mask of everybody.
+static void simtemp_wake_readers(struct nxp_simtemp_dev *dev)
+{
+    struct simtemp_file *ctx;
+    unsigned long flags;
+
+    wake_up_interruptible_all(&dev->wq);
+
+    spin_lock_irqsave(&dev->lock, flags);
+    list_for_each_entry(ctx, &dev->files, node)
+    {
+	if (simtemp_file_own_cursor(ctx))
+	{
+	    wake_up_interruptible(&ctx->wq);
+	}
+    }
+    spin_unlock_irqrestore(&dev->lock, flags);
+}
+
+//---------------Timer Callback (Data Generator) Producer------------------------------------------
+//------------------Data Producer [Kernel] periodic and precise ------------------ 
+// Activated each time when 'hrtimer' is triggered each 'sampling_ms'
+// Interruption context (Softirq) soft interruption
+enum hrtimer_restart simtemp_timer_callback(struct hrtimer *timer) //[kernel]
+{
+    // Obtains the memory address of 'nxp_simtemp_dev' through 'struct hrtimer *timer'
+    struct nxp_simtemp_dev *dev = container_of(timer, struct nxp_simtemp_dev, timer); //Macro [kernel] to navigates in memory, obtains the memory address
+    struct simtemp_sample   sample;	// access to timestamp_ns, temp_mC and flags
+    struct simtemp_file	   *ctx;	// open files attached to this device
+    const struct simtemp_config *cfg;	// configuration snapshot of this expiry
+    unsigned long flags;		// variable flag
+    s32 current_temp;
+    u32 random_offset;
+    u32 level_mask;		// levels exceeded by this sample
+    ktime_t now = hrtimer_cb_get_time(timer);	// time of this callback (CLOCK_MONOTONIC)
+    u64 jitter_ns;		// delay from the soft expiry
+    bool coalesced;		// another producer ran on this CPU in the same wakeup
+
+    //Timer Metrics: delay of this callback and coalescing with the other instances on this CPU
+    jitter_ns = max_t(s64, 0, ktime_to_ns(ktime_sub(now, hrtimer_get_softexpires(timer))));
+    coalesced = (u64)ktime_to_ns(now) - __this_cpu_read(simtemp_last_fire_ns) < SIMTEMP_COALESCE_NS;
+    __this_cpu_write(simtemp_last_fire_ns, ktime_to_ns(now));
+
+    //Data Generation
+
+    get_random_bytes(&random_offset, sizeof(random_offset));
+    current_temp = 45000 + (random_offset % 10000 ) - 5000;
+
+    sample.timestamp_ns = ktime_get_real_ns();	     //Generates a timestamp in nanoseconds
+    sample.temp_mC = current_temp;   //jiffies is a [kernel] counter 
+    sample.flags = SAMPLE_AVAILABLE;		//Sets bit 0 to indicate a sample available for Consumer (read()).	    
+
+    //Configuration Snapshot: read without locks, writers never block the producer
+    rcu_read_lock();
+    cfg = rcu_dereference(dev->cfg);
+
+    //---Start critical section--
+    //Ensuring atomicity (critical)
+    spin_lock_irqsave(&dev->lock, flags);   //Adquires 'Spinlock' and disable interruptions in CPU
+
+    //Threshold table: each level with its own hysteresis and alert counter
+    level_mask = simtemp_levels_update(dev, cfg, current_temp);
+
+    if(level_mask)
+    {
+	sample.flags |= TRESHOLD_CROSSED | (level_mask << SIMTEMP_LEVEL_SHIFT);
+	dev->alerts_count++;
+
+    }
+
+
+
+    //Data Writing [Logic]. Writes the sample in Ring Buffer through overwritting
+    simtemp_buffer_push(dev, &sample);	//If buffer is full moving the tail if necessary
+    simtemp_history_push(dev, &sample);	//History window: kept for non-destructive queries
+
+     dev->updates_count++;	 //Counter for Diagnostic Function
+
+    dev->timer_fires++;
+    dev->timer_coalesced += coalesced;
+    WRITE_ONCE(dev->producer_cpu, raw_smp_processor_id());	//Actual CPU of the producer (pinned or not)
+    dev->jitter_last_ns = jitter_ns;
+    dev->jitter_sum_ns += jitter_ns;
+    if (jitter_ns > dev->jitter_max_ns)
+    {
+	dev->jitter_max_ns = jitter_ns;
+    }
+
+    //Filtered and broadcast files are evaluated here over their own cursor: only the ones that accepted a sample are woken.
+    list_for_each_entry(ctx, &dev->files, node)
+    {
+	if (simtemp_file_own_cursor(ctx) && simtemp_filter_advance(dev, ctx))
+	{
+	    wake_up_interruptible(&ctx->wq);
+	}
+    }
+
+    //Liberates 'spin_unlock()' adquired by 'simtemp_call_back()' or 'read()' rutines.
+    spin_unlock_irqrestore(&dev->lock, flags); //Restores the interruptions states.
+
+    //[Kernel] Wake-up the processes of the shared queue that are slept in Wait Queue (wq).
+    //Blocked read() calls wait exclusively, so one sample wakes only one of them (plus the poll()/epoll() waiters).
+    wake_up_interruptible(&dev->wq); //Notifies the existence of new data to User Space processes
+   
+    
+    //--End critical section---
+
+
+    //Timer reassemble.
+    //Compensate latency (callback time) and programes the next trigger with the period of the snapshot
+    simtemp_timer_forward(timer, cfg, now); //Mantains the periodicity
+
+    rcu_read_unlock();
+
+    return HRTIMER_RESTART; //Data required by 'hrtimer' API [kernel] to timer comes back 
+}
+
+
+
+//------------------ Platform Device	 Functions     -----------------------------------/
+// ----------- Platform Device: File Interface Functions -------------
+
+//------nxp_simtemp_open() Function [Logic]-----------
+//'struct inode *inode' (/dev/simtemp) 
+//'struct file *file' are parameters [kernel] for Active Sesion Application-Driver. Equivalent to File Descriptor (fd) from Kernel.
+//"file" represents the specific instance during the opening
+static int nxp_simtemp_open(struct inode *inode, struct file *file)	    //Function [Logic] performed once when User Space opens the file /dev/simtemp
+{
+    //Recover the pointer to Global State struct(nxp_simtemp_dev). Useful for the following functions.
+    //'container_of' [kernel] obtains the pointer (file->private_data) from 'nxp_simtemp_dev' through 'mdev'
+    // Here is created '*nxp_dev' pointer
+    struct nxp_simtemp_dev *nxp_dev = container_of(file->private_data, struct nxp_simtemp_dev, mdev); 
+    struct simtemp_file *ctx;	    //Per-file context (filter and cursor of this aperture)
+    unsigned long flags;
+    int ret;
+
+    ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+    if (!ctx)
+    {
+	return -ENOMEM;
+    }
+
+    ctx->dev = nxp_dev;
+    kref_get(&nxp_dev->ref);			//Released by the last simtemp_dev_put() of release()
+    ctx->level_mask = SIMTEMP_LEVELS_ALL;	//Subscribed to every level by default (legacy POLLPRI)
+    init_waitqueue_head(&ctx->wq);
+
+    spin_lock_irqsave(&nxp_dev->lock, flags);
+    list_add_tail(&ctx->node, &nxp_dev->files);
+    spin_unlock_irqrestore(&nxp_dev->lock, flags);
+
+    file->private_data = ctx; //Stores the Per-file context in field (private_data) of structure (file). ctx->dev is the Driver Pointer.
+
+    //Lazy Producer: the first reader starts the hrtimer
+    mutex_lock(&nxp_dev->ctl_lock);
+    nxp_dev->users++;
+    ret = simtemp_producer_update(nxp_dev);
+    if (ret)
+    {
+	nxp_dev->users--;   //No producer: a blocking read() would never be woken, the open fails instead
+    }
+    mutex_unlock(&nxp_dev->ctl_lock);
+
+    if (ret)
+    {
+	spin_lock_irqsave(&nxp_dev->lock, flags);
+	list_del(&ctx->node);
+	spin_unlock_irqrestore(&nxp_dev->lock, flags);
+
+	kfree(ctx);
+	simtemp_dev_put(nxp_dev);
+	return ret;
+    }
+
+    return 0;
+}
+
+static int nxp_simtemp_release(struct inode *inode, struct file *file)	//Prototype of function performed when user space calls to close() or when the process end.
+{
+    struct simtemp_file *ctx = file->private_data;
+    struct nxp_simtemp_dev *dev = ctx->dev;
+    unsigned long flags;
+
+    //Here memory is liberated: the producer must not see this file anymore before kfree().
+    spin_lock_irqsave(&dev->lock, flags);
+    list_del(&ctx->node);
+    spin_unlock_irqrestore(&dev->lock, flags);
+
+    kfree(ctx);
+
+    //Lazy Producer: the last reader stops the hrtimer
+    mutex_lock(&dev->ctl_lock);
+    dev->users--;
+    simtemp_producer_update(dev);
+    mutex_unlock(&dev->ctl_lock);
+
+    //The device may have been removed while this file was open: its structure is freed with the last file
+    simtemp_dev_put(dev);
+
+    return 0;
+}
+
+//Read through the cursor of a filtered or broadcast file: the samples are taken from its own cursor,
+//the shared queue is not consumed. The reader sleeps in ctx->wq, woken only for the samples of this file.
+//Up to 'count' bytes are returned, copied in chunks of SIMTEMP_READ_BATCH samples (one critical section each).
+static ssize_t simtemp_read_cursor(struct file *file, struct simtemp_file *ctx, char __user *buf, size_t count)
+{
+    struct nxp_simtemp_dev *dev = ctx->dev;
+    struct simtemp_sample batch[SIMTEMP_READ_BATCH];
+    size_t max = count / sizeof(batch[0]);	//Samples requested by User Space
+    size_t done = 0;				//Samples already copied
+    unsigned long flags;
+    size_t n;
+
+    while (done < max)
+    {
+	n = 0;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	while (n < SIMTEMP_READ_BATCH && done + n < max && simtemp_filter_advance(dev, ctx))
+	{
+	    batch[n++] = dev->rb.buffer[ctx->cursor % RING_BUFFER_SIZE];
+	    ctx->cursor++;
+	    ctx->ready = false;
+	}
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	if (n == 0)
+	{
+	    //Something was already delivered: returned now instead of waiting for more
+	    if (done)
+	    {
+		break;
+	    }
+
+	    if (READ_ONCE(dev->dead))
+	    {
+		return -ENODEV;		//Device removed: no sample will ever come
+	    }
+
+	    if (file->f_flags & O_NONBLOCK)
+	    {
+		return -EAGAIN;
+	    }
+
+	    if (wait_event_interruptible(ctx->wq, simtemp_file_ready(dev, ctx)))
+	    {
+		return -ERESTARTSYS;
+	    }
+	    continue;
+	}
+
+	if (copy_to_user(buf + done * sizeof(batch[0]), batch, n * sizeof(batch[0])))
+	{
+	    return done ? done * sizeof(batch[0]) : -EFAULT;
+	}
+	done += n;
+    }
+
+    return done * sizeof(batch[0]);
+}
+
+// ----------- Platform Device: File Interface Functions -------------
+//---------nxp_simtemp_read() [Logic] Function--------- Consumer function for access to producer (hrtimer and Ring Buffer) performed in Kernel
+// *buf: Pointer(char*) to Destination Buffer for RAM memory of User Space reserves to receive the sensor.
+//char __user: Critical Qualifier of [kernel] to indicates this pointer (char*) does not belongs to Kernel.
+static ssize_t nxp_simtemp_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)      //Prototype of function performed when User Space calls to read().
+{
+    //[Logic] Retrieves the Per-file context and the pointer 'dev' from Global Structure from open()
+    struct simtemp_file *ctx = file->private_data;
+    struct nxp_simtemp_dev *dev = ctx->dev; //Asigns the memrory direction revovered from (file->private_data) to dev variable
+    
+    //Character Device Channel: Access to samples: timestamp_ns, temp_mC and flags.  
+    //Batch Reading: up to SIMTEMP_READ_BATCH samples are extracted per critical section (on the stack, 128 bytes)
+    //and copied to User Space outside of the spinlock. A read() of N samples returns every sample queued, up to N.
+    struct simtemp_sample batch[SIMTEMP_READ_BATCH];  //copy the registers from Kernel to User Space through Character Device Channel     
+    size_t max = count / sizeof(batch[0]);	//Samples requested by User Space
+    size_t done = 0;				//Samples already copied
+    size_t n;
+    unsigned long flags;	    //Saves interruptions states. Store and Restore the status of the interruptions.
+    
+    //Ring Buffer [Logic] must be large enough
+    if (count < sizeof(batch[0]))
+    {
+	return -EINVAL; //Error -22 Invalid Argument [kernel]: Buffer too small for sample.
+    }
+
+    //Filtered or broadcast file: the samples are taken from its own cursor, the shared queue is not consumed.
+    if (simtemp_file_own_cursor(ctx))
+    {
+	return simtemp_read_cursor(file, ctx, buf, count);
+    }
+
+    while (simtemp_buffer_is_empty(dev))
+    {
+	if (READ_ONCE(dev->dead))
+	{
+	    return -ENODEV;	//Device removed: no sample will ever come
+	}
+
+	if(file->f_flags & O_NONBLOCK)
+	{
+	    return -EAGAIN; 
+	}
+
+	//Exclusive wait (work-sharing): the producer wakes only one blocked reader per sample instead of all of them.
+	//The condition also ends the wait when this file switches to its own cursor (SIMTEMP_IOC_SET_DELIVERY/FILTER)
+	//and when the device is removed.
+	if (wait_event_interruptible_exclusive(dev->wq, !simtemp_buffer_is_empty(dev) || simtemp_file_own_cursor(ctx) ||
+					      READ_ONCE(dev->dead)))
+	{
+	    //The wakeup may have been meant for this reader: passed on so the sample is not left pending
+	    if (!simtemp_buffer_is_empty(dev))
+	    {
+		wake_up_interruptible(&dev->wq);
+	    }
+	    return -ERESTARTSYS;
+	}
+
+	if (simtemp_file_own_cursor(ctx))
+	{
+	    return simtemp_read_cursor(file, ctx, buf, count);
+	}
+    }
+
+    while (done < max)
+    {
+	n = 0;
+
+	//Atomic extraction. SpinLock is acquired
+	//Interrupts are disabled.
+	//hrtimer is locked to avoid to write in Ring Buffer while read() is reading 
+	//Avoids Race Condition.
+	spin_lock_irqsave(&dev->lock, flags);
+
+	//Buffer is readed.
+	//Calls to Ring Buffer [Logic] to extract the oldest data.
+	while (n < SIMTEMP_READ_BATCH && done + n < max && simtemp_buffer_pop(dev, &batch[n]))
+	{
+	    if ((batch[n].flags & TRESHOLD_CROSSED) && dev->alerts_count > 0)
+	    {
+		dev->alerts_count--;
+		simtemp_levels_ack(dev, batch[n].flags);	//Acknowledges the levels carried by the sample
+	    }
+	    n++;
+	}
+
+	// [Kernel] Liberates SpinLock.
+	// hrtimer returns to normal execution.
+	spin_unlock_irqrestore(&dev->lock, flags);	     
+
+	//Queue drained (or emptied by another reader just before the lock)
+	if (n == 0)
+	{
+	    break;
+	}
+
+	//Buffer Transfer [kernel]; Copies the Samples to Memory Direction of User Space Memory
+	//Only allows to write in the buffer *buf of __user type is ONLY this function. 
+	if (copy_to_user(buf + done * sizeof(batch[0]), batch, n * sizeof(batch[0])))
+	{
+	    // If copy fails...
+	    return done ? done * sizeof(batch[0]) : -EFAULT; //-14 [Kernel] Bad address
+	}
+	done += n;
+    }
+
+    //Samples left in the shared queue (the producer ran faster than this reader): the next exclusive waiter is woken
+    if (!simtemp_buffer_is_empty(dev))
+    {
+	wake_up_interruptible(&dev->wq);
+    }
+
+    if (done == 0)
+    {
+	return -EAGAIN; //Error -11 Try Again. [Kernel] Only if buffer is empty just before the lock.
+    }
+
+    return done * sizeof(batch[0]); //Returns the number of bytes (samples) in binary form reaed
+
+}
+
+// ----------- Platform Device: File Interface Functions -------------
+//---------nxp_simtemp_poll() [Logic]--------- Events Mechanism--------
+// Register the process like sleeping until data is ready and reports immediately.
+//struct file *file [kernel]: gives access to Driver State to know what resources to protect and which data to verify. Equivalent to File Descriptor (fd) from Kernel.
+//struct poll_table_struct *wait [kernel]: Register Mechanism of Callback that register the sleeping process from User Space in queue (wq)
+static __poll_t nxp_simtemp_poll(struct file *file, struct poll_table_struct *wait)	//function [Logic] performed when User Space calls to poll(), select() or epoll().
+{
+    struct simtemp_file *ctx = file->private_data;
+    struct nxp_simtemp_dev *dev = ctx->dev; //Saves pointer of Global Structure
+    
+    __poll_t mask = 0;	    //Maks for python
+    unsigned long flags;    // Saves interruptions states. Store and Restore the status of the interruptions.
+
+    //Device removed (unbind) while this file is open: the reader is told to close it
+    if (READ_ONCE(dev->dead))
+    {
+	return EPOLLHUP | EPOLLERR;
+    }
+
+    //Filtered or broadcast file: sleeps in its own Wait Queue and reports only accepted samples.
+    //POLLPRI is raised when the next deliverable sample exceeds a level subscribed by this file.
+    if (simtemp_file_own_cursor(ctx))
+    {
+	poll_wait(file, &ctx->wq, wait);
+
+	spin_lock_irqsave(&dev->lock, flags);
+	if (simtemp_filter_advance(dev, ctx))
+	{
+	    mask |= (EPOLLIN | EPOLLRDNORM);
+
+	    if (SIMTEMP_LEVEL_FLAGS(dev->rb.buffer[ctx->cursor % RING_BUFFER_SIZE].flags) & ctx->level_mask)
+	    {
+		mask |= EPOLLPRI;
+	    }
+	}
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	return mask;
+    }
+
+    // [kernel] Register this process in Wait Queue (wq)
+    // Crucial for the process to activate wake_up_interruptible and to be awakened.
+    // Add User Space information to Wait Queue (dev->wq) from Driver 
+    //Producer (hrtimer) calls to wake_up_interruptible(&dev->wq), Kernel reviews poll_table and wakes-up the Python Process
+    poll_wait(file, &dev->wq, wait);	// poll_wait Logic [kernel] from poll_table_struct
+
+      //Critical section starts that uses a temporal spinlock to access to shared variable 'alerts_count'
+    //Verificates alert events (Threshold)
+    
+    //spin_lock_irqsave(&dev->lock, flags);
+
+    //Check reading status (Disponible data)
+    if(!simtemp_buffer_is_empty(dev))
+    {
+	//mask to python
+	mask |= (EPOLLIN | POLLRDNORM); // Disponible Data. PollInput: File is ready for reading. PollReadNormal: Normal Lecture Flag (no urgent)
+    }
+
+    spin_lock_irqsave(&dev->lock, flags);
+
+    if(simtemp_levels_pending(dev) & ctx->level_mask)	    //Only the levels subscribed by this file
+    {
+	mask |= EPOLLPRI; //PollPriority: Event in high priotity
+    }
+    
+    spin_unlock_irqrestore(&dev->lock, flags);
+    //Critical section ends
+
+    
+    // Return of event mask (0 if must be waiting (sleeping)) or (>0 if wakes-up and performs read() function)
+    return mask; 
+
+
+}
+
+// ----------- Platform Device: File Interface Functions -------------
+//---------nxp_simtemp_ioctl() [Logic]--------- Per-file Control Channel--------
+//cmd: SIMTEMP_IOC_* command from nxp_simtemp_ioctl.h
+//arg: User Space pointer to the argument structure of the command
+static long nxp_simtemp_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+    struct simtemp_file *ctx = file->private_data;
+    struct nxp_simtemp_dev *dev = ctx->dev;
+    void __user *uarg = (void __user *)arg;
+    struct simtemp_filter filter;
+    struct simtemp_levels table;
+    struct simtemp_stats stats;
+    const struct simtemp_config *cfg;
+    unsigned long flags;
+    u32 mask;
+    u32 i;
+
+    if (READ_ONCE(dev->dead))
+    {
+	return -ENODEV;	    //Device removed while this file was open
+    }
+
+    switch (cmd)
+    {
+    case SIMTEMP_IOC_SET_FILTER:
+	if (copy_from_user(&filter, uarg, sizeof(filter)))
+	{
+	    return -EFAULT;
+	}
+
+	//Validation of input against unknown modes and inconsistent parameters
+	if ((filter.mode & ~SIMTEMP_FILTER_MASK) || filter.reserved)
+	{
+	    return -EINVAL;
+	}
+	if ((filter.mode & SIMTEMP_FILTER_RANGE) && filter.min_mC > filter.max_mC)
+	{
+	    return -EINVAL;
+	}
+	if ((filter.mode & SIMTEMP_FILTER_EVERY_N) && filter.every_n == 0)
+	{
+	    return -EINVAL;
+	}
+
+	//--------Critical Section: the producer walks dev->files and evaluates this filter---------
+	spin_lock_irqsave(&dev->lock, flags);
+
+	//The cursor starts at the samples still queued in the shared ring, so nothing pending is lost.
+	//A broadcast file keeps its cursor: it only starts to evaluate the new filter.
+	if (!simtemp_file_own_cursor(ctx))
+	{
+	    ctx->cursor = dev->rb.seq - dev->rb.count;
+	}
+	ctx->filter = filter;
+	ctx->ready = false;
+	ctx->has_last = false;
+	ctx->nth = 0;
+
+	spin_unlock_irqrestore(&dev->lock, flags);
+	//-------------------End of critical section---------------
+
+	//A reader blocked in this file may need to move to the other Wait Queue
+	wake_up_interruptible_all(&dev->wq);
+	wake_up_interruptible(&ctx->wq);
+
+	return 0;
+
+    case SIMTEMP_IOC_GET_FILTER:
+	spin_lock_irqsave(&dev->lock, flags);
+	filter = ctx->filter;
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	if (copy_to_user(uarg, &filter, sizeof(filter)))
+	{
+	    return -EFAULT;
+	}
+
+	return 0;
+
+    case SIMTEMP_IOC_SET_LEVELS:
+	if (copy_from_user(&table, uarg, sizeof(table)))
+	{
+	    return -EFAULT;
+	}
+
+	return simtemp_levels_apply(dev, &table);
+
+    case SIMTEMP_IOC_GET_LEVELS:
+	memset(&table, 0, sizeof(table));
+
+	rcu_read_lock();
+	cfg = rcu_dereference(dev->cfg);
+	table.count = cfg->nr_levels;
+	for (i = 0; i < cfg->nr_levels; i++)
+	{
+	    table.level[i].threshold_mC = cfg->levels[i].threshold_mC;
+	    table.level[i].hysteresis_mC = cfg->levels[i].hysteresis_mC;
+	}
+	rcu_read_unlock();
+
+	spin_lock_irqsave(&dev->lock, flags);
+	for (i = 0; i < table.count; i++)
+	{
+	    table.level[i].alerts = dev->levels[i].alerts;
+	}
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	if (copy_to_user(uarg, &table, sizeof(table)))
+	{
+	    return -EFAULT;
+	}
+
+	return 0;
+
+    case SIMTEMP_IOC_SET_LEVEL_MASK:
+	if (get_user(mask, (u32 __user *)uarg))
+	{
+	    return -EFAULT;
+	}
+	if (mask & ~SIMTEMP_LEVELS_ALL)
+	{
+	    return -EINVAL;
+	}
+
+	spin_lock_irqsave(&dev->lock, flags);
+	ctx->level_mask = mask;
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	wake_up_interruptible_all(&dev->wq);
+	wake_up_interruptible(&ctx->wq);
+
+	return 0;
+
+    case SIMTEMP_IOC_GET_LEVEL_MASK:
+	return put_user(ctx->level_mask, (u32 __user *)uarg);
+
+    case SIMTEMP_IOC_SET_DELIVERY:
+	if (get_user(mask, (u32 __user *)uarg))
+	{
+	    return -EFAULT;
+	}
+	if (mask != SIMTEMP_DELIVERY_SHARED && mask != SIMTEMP_DELIVERY_BROADCAST)
+	{
+	    return -EINVAL;
+	}
+
+	//--------Critical Section: the producer walks dev->files and advances the cursor of broadcast files---------
+	spin_lock_irqsave(&dev->lock, flags);
+
+	//A file that starts to use its own cursor starts at the samples still queued in the shared ring
+	if (!simtemp_file_own_cursor(ctx) && mask == SIMTEMP_DELIVERY_BROADCAST)
+	{
+	    ctx->cursor = dev->rb.seq - dev->rb.count;
+	    ctx->ready = false;
+	}
+	ctx->delivery = mask;
+
+	spin_unlock_irqrestore(&dev->lock, flags);
+	//-------------------End of critical section---------------
+
+	//A reader blocked in this file may need to move to the other Wait Queue
+	wake_up_interruptible_all(&dev->wq);
+	wake_up_interruptible(&ctx->wq);
+
+	return 0;
+
+    case SIMTEMP_IOC_GET_DELIVERY:
+	return put_user(ctx->delivery, (u32 __user *)uarg);
+
+    case SIMTEMP_IOC_GET_HISTORY:
+	return simtemp_history_query(dev, uarg);
+
+    case SIMTEMP_IOC_GET_STATS:
+	simtemp_stats_snapshot(dev, &stats);
+
+	if (copy_to_user(uarg, &stats, sizeof(stats)))
+	{
+	    return -EFAULT;
+	}
+
+	return 0;
+
+    default:
+	return -ENOTTY; //Unknown command for this device
+    }
+}
+
+//--------------------------  Sysfs Section (LifeCycle Functions) -----------------------------------
+
+//Object Device, arguments used in all syfs functions:
+//struct device *dev: [Kernel] through syfs. Generic Pointer to Platform Device (simtemp) in Device Tree of Kernel  
+//struct device_attribute *attr: [Kernel] Specific Pointer to Attrbute Definition to identify the file being read (/sys/.../sampling_ms) or (/sys/.../threshold_mC)
+//char *buf: Temporal Memory Buffer by User stored in kernel where Driver writes the output value in string formal.
+
+//sysfs Section: Reading Function: Show 
+//Attribute (R/W) 'sampling_ms_show' [Kernel]: Pointer .show within 'struct dev_attr_name' is mapped to this function. 
+//[SHOW] Reading of the period of actual sample (dev->sampling_ms)
+static ssize_t sampling_ms_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    //Obtains pointer to Global Structure. 
+    //nxp_simtemp_dev *nxp_dev: Specific context of driver, called fot the first time in nxp_simtemp_probe().
+    struct nxp_simtemp_dev *nxp_dev = dev_get_drvdata(dev); //Obtains the pointer through the object of device from 'dev' platform.
+    
+    ssize_t ret;	    //Return Variable
+
+    //--------RCU Read Section: Snapshot of the configuration---------
+    rcu_read_lock();
+
+    //Converts binary value of sampling_ms in string contained in buf
+    ret = sprintf(buf, "%u\n", rcu_dereference(nxp_dev->cfg)->sampling_ms); //Copy value to 'buf'
+    
+    rcu_read_unlock();
+    //-------------------End of RCU read section---------------
+
+    return ret;
+};
+
+//sysfs Section Writing Store Function: sampling_ms_store [Kernel]: Implemented when the User writes a new time value (milliseconds) to the file: /sys/.../sampling_ms
+//Attribute (R/W) 'sampling_ms_store': Pointer .store within 'struct dev_attr_name' is mapped to this function
+//[STORE] Writing of new period of sampling (published in a new Configuration Snapshot)
+//size_t count: Return of [Kernel] with bytes number processed for buf char. if was successful or error code if negative value
+//The hrtimer is never stopped: the callback applies the new period at its next expiry,
+//so the stream has no gap and the producer is never blocked by this writer.
+static ssize_t sampling_ms_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    //Obtains pointer to Global Structure. 
+    //nxp_simtemp_dev *nxp_dev: Specific context of driver, called fot the first time in nxp_simtemp_probe().
+    struct nxp_simtemp_dev *nxp_dev = dev_get_drvdata(dev); //Obtains the pointer through the object of device from 'dev' platform. 
+    
+    unsigned long value;    //Stores temporarily the numeric value of New Sampling Period through sysfs	      
+    struct simtemp_config *cfg;	//New Configuration Snapshot
+    int ret;		    //Return Variable
+
+    //Converts the input(strings) to numerical value (binary)
+    ret = kstrtoul(buf, 10, &value);
+
+    //Validation of input 
+    if (ret)
+    {
+	return ret;
+    }
+
+    //Validation of input against insecure values.
+    if(value < 10)
+    {
+	return -EINVAL; //Error -22 Invalid Argument [kernel]: Buffer too small for sample.
+    }
+
+    if(value > INT_MAX)
+    {
+	return -EINVAL;
+    }
+
+    //Writers are serialized by ctl_lock. The producer only reads the published snapshot.
+    mutex_lock(&nxp_dev->ctl_lock);
+
+    cfg = simtemp_config_edit(nxp_dev);
+    if (!cfg)
+    {
+	mutex_unlock(&nxp_dev->ctl_lock);
+	return -ENOMEM;
+    }
+
+    //Updating the configuration variables.
+    cfg->sampling_ms = (s32)value;	//Adapts value to miliseconds for sampling 
+    cfg->period_ns = ms_to_ktime(cfg->sampling_ms); //Converts the sample of ms to ns for hrtimer.
+    cfg->slack_ns = min_t(u64, cfg->slack_ns, ktime_to_ns(cfg->period_ns));	//The slack never exceeds the period
+
+    //Published: a running timer applies it at its next expiry, a stopped one when it is started.
+    simtemp_config_publish(nxp_dev, cfg);
+
+    mutex_unlock(&nxp_dev->ctl_lock);
+
+    return count; //Return number of bytes processed.
+};
+
+//Reading Function threshold_mC_show: Performed when User Space reads /sys/.../threshold_mC (cat comand...)
+//Attribute (R/W) 'threshold_mC_show': Updates one variable
+//size_t count: Return of [Kernel] with bytes number processed for buf char. if was successful or error code if negative value
+//[SHOW] Reading of alert umbral for sysfs and exposes the internal value of Driver to User Space
+static ssize_t threshold_mC_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct nxp_simtemp_dev *nxp_dev = dev_get_drvdata(dev); //Obtains the pointer through the object of device from 'dev' platform.
+    
+    ssize_t ret;	    //Return Variable
+
+    //--------RCU Read Section: Snapshot of the configuration---------
+    rcu_read_lock();
+
+    //Converts binary value of level 0 (legacy threshold_mC) in string contained in buf
+    ret = sprintf(buf, "%d\n", rcu_dereference(nxp_dev->cfg)->levels[0].threshold_mC); //Indicates how many bytes were writes in this buffer.
+
+    rcu_read_unlock();
+    //-------------------End of RCU read section---------------
+
+    return ret; 
+}
+
+//----- sysfs Section -	 threshold mC store [Kernel] (Reading Function).
+//Attribute (R/W) 'threshold_mC_store': Pointer .store is mapped to this function Updates one variable
+//[STORE] Writing the new umbral of alert
+static ssize_t threshold_mC_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct nxp_simtemp_dev *nxp_dev = dev_get_drvdata(dev); //Obtains the pointer through the object of device from 'dev' platform.
+    s32 value;		    //Data Type of Kernel signed 32bits for threshold_mC
+    
+    struct simtemp_config *cfg;	//New Configuration Snapshot
+    int ret;		    //Return Variable
+
+    //Converts string input to int 32 bits
+    ret = kstrtos32(buf, 10, &value);
+    if (ret)
+    {
+	return ret;
+    }
+
+    mutex_lock(&nxp_dev->ctl_lock);
+
+    cfg = simtemp_config_edit(nxp_dev);
+    if (!cfg)
+    {
+	mutex_unlock(&nxp_dev->ctl_lock);
+	return -ENOMEM;
+    }
+
+    cfg->levels[0].threshold_mC = value;  //Configuration Changes by User Space for threshold_mC (level 0 of the table)
+    if (cfg->nr_levels == 0)
+    {
+	cfg->nr_levels = 1;	    //Writing the legacy threshold enables level 0 again
+	cfg->levels_gen++;
+    }
+
+    //Published: the next sample is evaluated against the new threshold
+    simtemp_config_publish(nxp_dev, cfg);
+
+    mutex_unlock(&nxp_dev->ctl_lock);
+
+    
+    //Wakes-up all processes that are currently sleeping in wait queue (wq) and in the per-file queues
+    simtemp_wake_readers(nxp_dev);
+
+    return count;   //Return number of bytes processed.
+
+
+}
+
+
+
+// ----- sysfs Section - 'clear_alert_store' function [kernel] Acknoledge of Alert Count   
+// Attribute (RO) 'clear_alert_store': Pointer .clear_alert
+static ssize_t clear_alert_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct nxp_simtemp_dev *nxp_dev = dev_get_drvdata(dev); //Obtains the pointer through the object of device from 'dev' platform.
+    unsigned long flags;    // Saves interruptions states. Store and Restore the status of the interruptions.
+    u32 i;
+
+    //--------Critical Section: Disables the interruptions---------
+
+    spin_lock_irqsave(&nxp_dev->lock, flags);	//Acquires the spinlock and avoid the hrtimer_callback add a new alert to alerts_count
+
+    nxp_dev->alerts_count = 0;	//Resets the counter of alerts to 0
+    for (i = 0; i < SIMTEMP_MAX_LEVELS; i++)
+    {
+	nxp_dev->levels[i].alerts = 0;	//Resets the alert counter of every level
+    }
+
+    spin_unlock_irqrestore(&nxp_dev->lock, flags);  //Restore the original state of interruptions
+
+    //-------------------End of critical section--------------
+
+    simtemp_wake_readers(nxp_dev);	    //Notifies to the processes in dev->wq and in the per-file queues
+
+    return count; //Returns the number of bytes processed
+
+}
+
+//----- sysfs Section - stats_show function [Kernel]: Diagnostic Function. Implements the Diagnostic Attribute of Driver in sysfs
+//Applies a new value to the alert threshold for system monitoring.
+//Attribute (R/O) 'stats': Pointer .show is mapped to this function. Shows the counters of diagnostic in existence: updates_count, alerts_count.
+//[SHOW] Reading of statiticals (updates_count, alerts_count and last errors)
+static ssize_t stats_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct nxp_simtemp_dev *nxp_dev = dev_get_drvdata(dev); //Obtains the pointer through the object of device from 'dev' platform.
+    
+    unsigned long flags;    // Saves interruptions states. Store and Restore the status of the interruptions.
+    ssize_t ret;	    //Return Variable
+
+    //--------Critical Section: ---------
+    spin_lock_irqsave(&nxp_dev->lock, flags);	//Prevents that hrtimer_callback() access to nxp_dev->lock
+
+    //Formats the output like a legible string with all counters.
+    ret = sprintf(buf, "updates = %u\nalerts = %u\nlast error = %d\nreaders = %u\nproducer = %s\n"
+		  "timer fires = %llu\nwakeups = %llu\njitter last ns = %llu\njitter max ns = %llu\njitter avg ns = %llu\n"
+		  "config updates = %llu\nproducer cpu = %d\noverflows = %llu\n",
+		  nxp_dev->updates_count, nxp_dev->alerts_count, 0,
+		  READ_ONCE(nxp_dev->users), READ_ONCE(nxp_dev->running) ? "running" : "stopped",
+		  nxp_dev->timer_fires, nxp_dev->timer_fires - nxp_dev->timer_coalesced,
+		  nxp_dev->jitter_last_ns, nxp_dev->jitter_max_ns,
+		  nxp_dev->timer_fires ? div64_u64(nxp_dev->jitter_sum_ns, nxp_dev->timer_fires) : 0,
+		  READ_ONCE(nxp_dev->cfg_updates), READ_ONCE(nxp_dev->producer_cpu), nxp_dev->overflows);
+    
+    spin_unlock_irqrestore(&nxp_dev->lock, flags);  //hrtimer is restored with a new time interval.
+
+    
+    //-------------------End of critical section--------------
+
+    return ret; //Returns number of bytes from 'buf'. 
+};
+
+
+
+
+//Statistics Snapshot: every counter of 'stats' in binary form (struct simtemp_stats).
+//The configuration comes from the RCU snapshot, the counters are copied under one lock so they are consistent.
+static void simtemp_stats_snapshot(struct nxp_simtemp_dev *dev, struct simtemp_stats *st)
+{
+    const struct simtemp_config *cfg;
+    unsigned long flags;
+    u32 i;
+
+    memset(st, 0, sizeof(*st));
+    st->size = sizeof(*st);
+    st->index = dev->index;
+
+    rcu_read_lock();
+    cfg = rcu_dereference(dev->cfg);
+    st->sampling_ms = cfg->sampling_ms;
+    st->threshold_mC = cfg->levels[0].threshold_mC;
+    st->nr_levels = cfg->nr_levels;
+    rcu_read_unlock();
+
+    //--------Critical Section: counters of the producer---------
+    spin_lock_irqsave(&dev->lock, flags);
+
+    st->updates = dev->updates_count;
+    st->overflows = dev->overflows;
+    st->timer_fires = dev->timer_fires;
+    st->wakeups = dev->timer_fires - dev->timer_coalesced;
+    st->jitter_last_ns = dev->jitter_last_ns;
+    st->jitter_max_ns = dev->jitter_max_ns;
+    st->jitter_sum_ns = dev->jitter_sum_ns;
+    st->alerts = dev->alerts_count;
+    st->queued = dev->rb.count;
+    for (i = 0; i < SIMTEMP_MAX_LEVELS; i++)
+    {
+	st->level_alerts[i] = dev->levels[i].alerts;
+	st->level_alerts_total[i] = dev->levels[i].alerts_total;
+    }
+
+    spin_unlock_irqrestore(&dev->lock, flags);
+    //-------------------End of critical section--------------
+
+    st->config_updates = READ_ONCE(dev->cfg_updates);
+    st->readers = READ_ONCE(dev->users);
+    st->running = READ_ONCE(dev->running);
+    st->producer_cpu = READ_ONCE(dev->producer_cpu);
+}
+
+//----- sysfs Section - stats_bin_read function [Kernel]: Binary attribute with the statistics snapshot.
+//Attribute (RO) 'stats_bin': a collector keeps it open and calls pread(fd, &st, sizeof(st), 0) on each scrape.
+//No text formatting nor parsing: one copy of struct simtemp_stats per instance.
+static ssize_t stats_bin_read(struct file *filp, struct kobject *kobj, const struct bin_attribute *attr,
+			      char *buf, loff_t off, size_t count)
+{
+    struct nxp_simtemp_dev *nxp_dev = dev_get_drvdata(kobj_to_dev(kobj));  //Attribute of the platform device
+    struct simtemp_stats st;
+
+    simtemp_stats_snapshot(nxp_dev, &st);
+
+    return memory_read_from_buffer(buf, count, &off, &st, sizeof(st));
+}
+
+
+//----- sysfs Section - levels_show function [Kernel]: Threshold table, one line per level.
+//Format: "<level>: threshold_mC=<t> hysteresis_mC=<h> alerts=<n>"
+static ssize_t levels_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct nxp_simtemp_dev *nxp_dev = dev_get_drvdata(dev); //Obtains the pointer through the object of device from 'dev' platform.
+    struct simtemp_levels table;
+    const struct simtemp_config *cfg;
+    unsigned long flags;
+    ssize_t ret = 0;
+    u32 i;
+
+    //--------RCU Read Section: thresholds of the published snapshot---------
+    rcu_read_lock();
+    cfg = rcu_dereference(nxp_dev->cfg);
+    table.count = cfg->nr_levels;
+    for (i = 0; i < cfg->nr_levels; i++)
+    {
+	table.level[i].threshold_mC = cfg->levels[i].threshold_mC;
+	table.level[i].hysteresis_mC = cfg->levels[i].hysteresis_mC;
+    }
+    rcu_read_unlock();
+
+    //--------Critical Section: alert counters of the producer---------
+    spin_lock_irqsave(&nxp_dev->lock, flags);
+    for (i = 0; i < table.count; i++)
+    {
+	table.level[i].alerts = nxp_dev->levels[i].alerts;
+    }
+    spin_unlock_irqrestore(&nxp_dev->lock, flags);
+    //-------------------End of critical section---------------
+
+    for (i = 0; i < table.count; i++)
+    {
+	ret += sysfs_emit_at(buf, ret, "%u: threshold_mC=%d hysteresis_mC=%u alerts=%u\n",
+			     i, table.level[i].threshold_mC, table.level[i].hysteresis_mC, table.level[i].alerts);
+    }
+
+    return ret;
+}
+
+//----- sysfs Section - levels_store function [Kernel]: Replaces the whole threshold table atomically.
+//Format: up to SIMTEMP_MAX_LEVELS entries "<threshold_mC>[:<hysteresis_mC>]" separated by spaces.
+//Example: echo "45000:1000 55000:1000 65000:500" > levels
+static ssize_t levels_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct nxp_simtemp_dev *nxp_dev = dev_get_drvdata(dev); //Obtains the pointer through the object of device from 'dev' platform.
+    struct simtemp_levels table = { 0 };
+    char *copy, *cursor, *token, *hyst;
+    int ret = 0;
+
+    copy = kstrndup(buf, count, GFP_KERNEL);
+    if (!copy)
+    {
+	return -ENOMEM;
+    }
+
+    //Parsing: the whole input is validated before the table is touched
+    cursor = strim(copy);
+    while ((token = strsep(&cursor, " \t\n")) != NULL)
+    {
+	if (*token == '\0')
+	{
+	    continue;
+	}
+
+	if (table.count == SIMTEMP_MAX_LEVELS)
+	{
+	    ret = -EINVAL;  //Too many levels
+	    break;
+	}
+
+	hyst = strchr(token, ':');
+	if (hyst)
 	{
-	    // If copy fails...
-	    return -EFAULT; //-14 [Kernel] Bad address
+	    *hyst++ = '\0';
+	    ret = kstrtou32(hyst, 10, &table.level[table.count].hysteresis_mC);
+	    if (ret)
+	    {
+		break;
+	    }
+	}
 
+	ret = kstrtos32(token, 10, &table.level[table.count].threshold_mC);
+	if (ret)
+	{
+	    break;
 	}
 
+	table.count++;
+    }
+
+    kfree(copy);
 
+    if (ret)
+    {
+	return ret;
     }
 
-    return retval; //Returns the number of bytes (sample) in binary form reaed from (sizeof(sample))
+    ret = simtemp_levels_apply(nxp_dev, &table);
 
+    return ret ? ret : count;	//Return number of bytes processed.
 }
 
-// ----------- Platform Device: File Interface Functions -------------
-//---------nxp_simtemp_poll() [Logic]--------- Events Mechanism--------
-// Register the process like sleeping until data is ready and reports immediately.
-//struct file *file [kernel]: gives access to Driver State to know what resources to protect and which data to verify. Equivalent to File Descriptor (fd) from Kernel.
-//struct poll_table_struct *wait [kernel]: Register Mechanism of Callback that register the sleeping process from User Space in queue (wq)
-static __poll_t nxp_simtemp_poll(struct file *file, struct poll_table_struct *wait)	//function [Logic] performed when User Space calls to poll(), select() or epoll().
+//----- sysfs Section - always_on show/store [Kernel]: Override of the Lazy Producer.
+//1: the hrtimer keeps running without readers (ring keeps the recent history). 0: runs only while /dev/simtemp is open.
+static ssize_t always_on_show(struct device *dev, struct device_attribute *attr, char *buf)
 {
-    struct nxp_simtemp_dev *dev = file->private_data; //Saves pointer of Global Structure
-    
-    __poll_t mask = 0;	    //Maks for python
-    unsigned long flags;    // Saves interruptions states. Store and Restore the status of the interruptions.
+    struct nxp_simtemp_dev *nxp_dev = dev_get_drvdata(dev); //Obtains the pointer through the object of device from 'dev' platform.
 
-    // [kernel] Register this process in Wait Queue (wq)
-    // Crucial for the process to activate wake_up_interruptible and to be awakened.
-    // Add User Space information to Wait Queue (dev->wq) from Driver 
-    //Producer (hrtimer) calls to wake_up_interruptible(&dev->wq), Kernel reviews poll_table and wakes-up the Python Process
-    poll_wait(file, &dev->wq, wait);	// poll_wait Logic [kernel] from poll_table_struct
+    return sprintf(buf, "%d\n", READ_ONCE(nxp_dev->always_on));
+}
 
-      //Critical section starts that uses a temporal spinlock to access to shared variable 'alerts_count'
-    //Verificates alert events (Threshold)
-    
-    //spin_lock_irqsave(&dev->lock, flags);
+static ssize_t always_on_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct nxp_simtemp_dev *nxp_dev = dev_get_drvdata(dev); //Obtains the pointer through the object of device from 'dev' platform.
+    bool value;
+    int ret;
 
-    //Check reading status (Disponible data)
-    if(!simtemp_buffer_is_empty(dev))
+    ret = kstrtobool(buf, &value);
+    if (ret)
     {
-	//mask to python
-	mask |= (EPOLLIN | POLLRDNORM); // Disponible Data. PollInput: File is ready for reading. PollReadNormal: Normal Lecture Flag (no urgent)
+	return ret;
     }
 
-    spin_lock_irqsave(&dev->lock, flags);
-
-    if(dev->alerts_count >0)	    //Global Variable
+    mutex_lock(&nxp_dev->ctl_lock);
+    nxp_dev->always_on = value;
+    ret = simtemp_producer_update(nxp_dev);	//Starts or stops the hrtimer if the override changes its state
+    if (ret)
     {
-	mask |= EPOLLPRI; //PollPriority: Event in high priotity
+	nxp_dev->always_on = false;		//Only starting can fail: the override is not kept without a producer
     }
-    
-    spin_unlock_irqrestore(&dev->lock, flags);
-    //Critical section ends
-
-    
-    // Return of event mask (0 if must be waiting (sleeping)) or (>0 if wakes-up and performs read() function)
-    return mask; 
-
+    mutex_unlock(&nxp_dev->ctl_lock);
 
+    return ret ? ret : count;	//Return number of bytes processed.
 }
 
-//--------------------------  Sysfs Section (LifeCycle Functions) -----------------------------------
+//----- sysfs Section - history_len show/store [Kernel]: Length of the history window in samples.
+//Rounded up to a power of two (read back the value applied), 0 disables the window. The newest samples are kept.
+static ssize_t history_len_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct nxp_simtemp_dev *nxp_dev = dev_get_drvdata(dev); //Obtains the pointer through the object of device from 'dev' platform.
 
-//Object Device, arguments used in all syfs functions:
-//struct device *dev: [Kernel] through syfs. Generic Pointer to Platform Device (simtemp) in Device Tree of Kernel  
-//struct device_attribute *attr: [Kernel] Specific Pointer to Attrbute Definition to identify the file being read (/sys/.../sampling_ms) or (/sys/.../threshold_mC)
-//char *buf: Temporal Memory Buffer by User stored in kernel where Driver writes the output value in string formal.
+    return sprintf(buf, "%u\n", READ_ONCE(nxp_dev->hist.len));
+}
 
-//sysfs Section: Reading Function: Show 
-//Attribute (R/W) 'sampling_ms_show' [Kernel]: Pointer .show within 'struct dev_attr_name' is mapped to this function. 
-//[SHOW] Reading of the period of actual sample (dev->sampling_ms)
-static ssize_t sampling_ms_show(struct device *dev, struct device_attribute *attr, char *buf)
+static ssize_t history_len_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
 {
-    //Obtains pointer to Global Structure. 
-    //nxp_simtemp_dev *nxp_dev: Specific context of driver, called fot the first time in nxp_simtemp_probe().
     struct nxp_simtemp_dev *nxp_dev = dev_get_drvdata(dev); //Obtains the pointer through the object of device from 'dev' platform.
-    
-    unsigned long flags;    //Saves interruptions states. Store and Restore the status of the interruptions.
-    ssize_t ret;	    //Return Variable
+    u32 value;
+    int ret;
 
-    //--------Critical Section: Protects access to shared variable---------
-    spin_lock_irqsave(&nxp_dev->lock, flags);
+    ret = kstrtou32(buf, 10, &value);
+    if (ret)
+    {
+	return ret;
+    }
 
-    //Converts binary value of nxp_dev->threshold_mC in string contained in buf
-    ret = sprintf(buf, "%u\n", nxp_dev->sampling_ms); //Copy value to 'buf'
-    
-    spin_unlock_irqrestore(&nxp_dev->lock, flags);
-    //-------------------End of critical section---------------
+    if (value > SIMTEMP_HISTORY_MAX)
+    {
+	return -EINVAL;
+    }
 
-    return ret;
-};
+    ret = simtemp_history_resize(nxp_dev, value);
 
-//sysfs Section Writing Store Function: sampling_ms_store [Kernel]: Implemented when the User writes a new time value (milliseconds) to the file: /sys/.../sampling_ms
-//Attribute (R/W) 'sampling_ms_store': Pointer .store within 'struct dev_attr_name' is mapped to this function
-//[STORE] Writing of new period of sampling (Restores Stops/Restarts hrtimer)
-//size_t count: Return of [Kernel] with bytes number processed for buf char. if was successful or error code if negative value
-//Timer Driver hrtimer is stopped/restarted and period is updated.
-//Actual testing7configuration logic is executed.
-static ssize_t sampling_ms_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+    return ret ? ret : count;	//Return number of bytes processed.
+}
+
+//----- sysfs Section - Timer Reconfiguration helper: publishes a snapshot with the new slack and/or mode.
+//The producer is not stopped: simtemp_timer_forward() programs the next expiry with it.
+//A negative 'slack_ns' keeps the current slack, a negative 'mode' keeps the current mode.
+static int simtemp_timer_reconfigure(struct nxp_simtemp_dev *dev, s64 slack_ns, int mode)
 {
-    //Obtains pointer to Global Structure. 
-    //nxp_simtemp_dev *nxp_dev: Specific context of driver, called fot the first time in nxp_simtemp_probe().
-    struct nxp_simtemp_dev *nxp_dev = dev_get_drvdata(dev); //Obtains the pointer through the object of device from 'dev' platform. 
-    
-    unsigned long value;    //Stores temporarily the numeric value of New Sampling Period through sysfs	      
-    unsigned long flags;    //Saves interruptions states. Store and Restore the status of the interruptions. 
-    int ret;		    //Return Variable
+    struct simtemp_config *cfg;
 
-    //Converts the input(strings) to numerical value (binary)
-    ret = kstrtoul(buf, 10, &value);
+    mutex_lock(&dev->ctl_lock);
 
-    //Validation of input 
-    if (ret)
+    cfg = simtemp_config_edit(dev);
+    if (!cfg)
     {
-	return ret;
+	mutex_unlock(&dev->ctl_lock);
+	return -ENOMEM;
     }
 
-    //Validation of input against insecure values.
-    if(value < 10)
+    //Validation of input: the slack can not be longer than the period itself
+    if (slack_ns > ktime_to_ns(cfg->period_ns))
     {
-	return -EINVAL; //Error -22 Invalid Argument [kernel]: Buffer too small for sample.
+	mutex_unlock(&dev->ctl_lock);
+	kfree(cfg);
+	return -EINVAL;
     }
 
-    //--------Critical Section: Stops, Updates and Restarts the hrtimer---------
-    spin_lock_irqsave(&nxp_dev->lock, flags);
-
-    //Cancel the timer to update period without race conditions
-    hrtimer_cancel(&nxp_dev->timer);
-
-    //Updating the state variables.
-    nxp_dev->sampling_ms = (s32)value;	//Adapts value to miliseconds for sampling 
-    nxp_dev->period_ns = ms_to_ktime(nxp_dev->sampling_ms); //Converts the sample of ms to ns for hrtimer.
+    if (slack_ns >= 0)
+    {
+	cfg->slack_ns = slack_ns;
+    }
+    if (mode >= 0)
+    {
+	cfg->timer_mode = mode;
+    }
 
-    //Restarts timer with new period.
-    hrtimer_start(&nxp_dev->timer, nxp_dev->period_ns, HRTIMER_MODE_REL);   //HRTIMER_MODE_REL: Flag of hrtimer to specify that the time provided is relative with respect to actual time.
+    simtemp_config_publish(dev, cfg);
 
-    spin_unlock_irqrestore(&nxp_dev->lock, flags);  //hrtimer is restored with a new time interval.
-    //-------------------  End of critical section  --------------------------
+    mutex_unlock(&dev->ctl_lock);
 
-    return count; //Return number of bytes processed.
-};
+    return 0;
+}
 
-//Reading Function threshold_mC_show: Performed when User Space reads /sys/.../threshold_mC (cat comand...)
-//Attribute (R/W) 'threshold_mC_show': Updates one variable
-//size_t count: Return of [Kernel] with bytes number processed for buf char. if was successful or error code if negative value
-//[SHOW] Reading of alert umbral for sysfs and exposes the internal value of Driver to User Space
-static ssize_t threshold_mC_show(struct device *dev, struct device_attribute *attr, char *buf)
+//----- sysfs Section - timer_slack_ns show/store [Kernel]: Precision vs Coalescing of the producer.
+//0: exact expiries. >0: the expiry may be delayed up to this value to share a wakeup with other timers.
+static ssize_t timer_slack_ns_show(struct device *dev, struct device_attribute *attr, char *buf)
 {
     struct nxp_simtemp_dev *nxp_dev = dev_get_drvdata(dev); //Obtains the pointer through the object of device from 'dev' platform.
-    
-    unsigned long flags;    //Saves interruptions states. Store and Restore the status of the interruptions.
-    ssize_t ret;	    //Return Variable
-
-    //--------Critical Section: Protects access to shared variable ---------
-    spin_lock_irqsave(&nxp_dev->lock, flags);	//Prevents that hrtimer_callback() access to nxp_dev->threshold_mC
 
-    //Converts binary value of nxp_dev->threshold_mC in string contained in buf
-    ret = sprintf(buf, "%d\n", nxp_dev->threshold_mC); //Indicates how many bytes were writes in this buffer.
+    ssize_t ret;
 
-    spin_unlock_irqrestore(&nxp_dev->lock, flags);  //hrtimer is restored with a new time interval.
-    //-------------------End of critical section---------------
+    rcu_read_lock();
+    ret = sprintf(buf, "%llu\n", rcu_dereference(nxp_dev->cfg)->slack_ns);
+    rcu_read_unlock();
 
-    return ret; 
+    return ret;
 }
 
-//----- sysfs Section -	 threshold mC store [Kernel] (Reading Function).
-//Attribute (R/W) 'threshold_mC_store': Pointer .store is mapped to this function Updates one variable
-//[STORE] Writing the new umbral of alert
-static ssize_t threshold_mC_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+static ssize_t timer_slack_ns_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
 {
     struct nxp_simtemp_dev *nxp_dev = dev_get_drvdata(dev); //Obtains the pointer through the object of device from 'dev' platform.
-    s32 value;		    //Data Type of Kernel signed 32bits for threshold_mC
-    
-    unsigned long flags;    //Saves interruptions states. Store and Restore the status of the interruptions.
-    int ret;		    //Return Variable
+    u64 value;
+    int ret;
 
-    //Converts string input to int 32 bits
-    ret = kstrtos32(buf, 10, &value);
+    ret = kstrtou64(buf, 10, &value);
     if (ret)
     {
 	return ret;
     }
 
-     //--------Critical Section: ---------
-    spin_lock_irqsave(&nxp_dev->lock, flags);	//Prevents that hrtimer_callback() access to nxp_dev->threshold_mC
-
-    nxp_dev->threshold_mC = value;  //Configuration Changes by User Space for threshold_mC
-
-    spin_unlock_irqrestore(&nxp_dev->lock, flags);  //hrtimer is restored with a new time interval.
-    //-------------------End of critical section---------------
-
-    
-    //Wakes-up all processes that are currently sleeping in wait queue (wq)
-    wake_up_interruptible(&nxp_dev->wq);
-
-    return count;   //Return number of bytes processed.
+    if (value > S64_MAX)
+    {
+	return -EINVAL;
+    }
 
+    //Validated against the period of the snapshot being edited
+    ret = simtemp_timer_reconfigure(nxp_dev, value, -1);
 
+    return ret ? ret : count;   //Return number of bytes processed.
 }
 
-
-
-// ----- sysfs Section - 'clear_alert_store' function [kernel] Acknoledge of Alert Count   
-// Attribute (RO) 'clear_alert_store': Pointer .clear_alert
-static ssize_t clear_alert_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+//----- sysfs Section - producer_cpus show/store [Kernel]: CPU list of the producer ("2", "2-3", "0,4").
+//An empty list (echo > producer_cpus) removes the affinity. A running producer is moved at once.
+static ssize_t producer_cpus_show(struct device *dev, struct device_attribute *attr, char *buf)
 {
     struct nxp_simtemp_dev *nxp_dev = dev_get_drvdata(dev); //Obtains the pointer through the object of device from 'dev' platform.
-    unsigned long flags;    // Saves interruptions states. Store and Restore the status of the interruptions.
-
-    //--------Critical Section: Disables the interruptions---------
+    ssize_t ret;
 
-    spin_lock_irqsave(&nxp_dev->lock, flags);	//Acquires the spinlock and avoid the hrtimer_callback add a new alert to alerts_count
+    mutex_lock(&nxp_dev->ctl_lock);
+    ret = sysfs_emit(buf, "%*pbl\n", cpumask_pr_args(&nxp_dev->producer_cpus));
+    mutex_unlock(&nxp_dev->ctl_lock);
 
-    nxp_dev->alerts_count = 0;	//Resets the counter of alerts to 0
+    return ret;
+}
 
-    spin_unlock_irqrestore(&nxp_dev->lock, flags);  //Restore the original state of interruptions
+static ssize_t producer_cpus_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct nxp_simtemp_dev *nxp_dev = dev_get_drvdata(dev); //Obtains the pointer through the object of device from 'dev' platform.
+    struct cpumask mask;
+    int ret;
 
-    //-------------------End of critical section--------------
+    ret = cpulist_parse(buf, &mask);
+    if (ret)
+    {
+	return ret;
+    }
 
-    wake_up_interruptible(&nxp_dev->wq);    //Notifies to the processes in dev->wq
+    //Validation of input: a non empty list must contain at least one online CPU
+    if (!cpumask_empty(&mask) && !cpumask_intersects(&mask, cpu_online_mask))
+    {
+	return -EINVAL;
+    }
 
-    return count; //Returns the number of bytes processed
+    mutex_lock(&nxp_dev->ctl_lock);
+    cpumask_copy(&nxp_dev->producer_cpus, &mask);
+    simtemp_producer_migrate(nxp_dev);
+    mutex_unlock(&nxp_dev->ctl_lock);
 
+    return count;   //Return number of bytes processed.
 }
 
-//----- sysfs Section - stats_show function [Kernel]: Diagnostic Function. Implements the Diagnostic Attribute of Driver in sysfs
-//Applies a new value to the alert threshold for system monitoring.
-//Attribute (R/O) 'stats': Pointer .show is mapped to this function. Shows the counters of diagnostic in existence: updates_count, alerts_count.
-//[SHOW] Reading of statiticals (updates_count, alerts_count and last errors)
-static ssize_t stats_show(struct device *dev, struct device_attribute *attr, char *buf)
+//----- sysfs Section - timer_mode show/store [Kernel]: "relative" or "aligned" (phase-locked to the period boundary)
+static ssize_t timer_mode_show(struct device *dev, struct device_attribute *attr, char *buf)
 {
     struct nxp_simtemp_dev *nxp_dev = dev_get_drvdata(dev); //Obtains the pointer through the object of device from 'dev' platform.
-    
-    unsigned long flags;    // Saves interruptions states. Store and Restore the status of the interruptions.
-    ssize_t ret;	    //Return Variable
 
-    //--------Critical Section: ---------
-    spin_lock_irqsave(&nxp_dev->lock, flags);	//Prevents that hrtimer_callback() access to nxp_dev->lock
+    ssize_t ret;
 
-    //Formats the output like a legible string with all counters.
-    ret = sprintf(buf, "updates = %u\nalerts = %u\nlast error = %d\n", nxp_dev->updates_count, nxp_dev->alerts_count, 0); 
-    
-    spin_unlock_irqrestore(&nxp_dev->lock, flags);  //hrtimer is restored with a new time interval.
+    rcu_read_lock();
+    ret = sprintf(buf, "%s\n", rcu_dereference(nxp_dev->cfg)->timer_mode == SIMTEMP_TIMER_ALIGNED ? "aligned" : "relative");
+    rcu_read_unlock();
 
-    
-    //-------------------End of critical section--------------
+    return ret;
+}
 
-    return ret; //Returns number of bytes from 'buf'. 
-};
+static ssize_t timer_mode_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct nxp_simtemp_dev *nxp_dev = dev_get_drvdata(dev); //Obtains the pointer through the object of device from 'dev' platform.
+    enum simtemp_timer_mode mode;
+    int ret;
 
+    if (sysfs_streq(buf, "aligned"))
+    {
+	mode = SIMTEMP_TIMER_ALIGNED;
+    }
+    else if (sysfs_streq(buf, "relative"))
+    {
+	mode = SIMTEMP_TIMER_RELATIVE;
+    }
+    else
+    {
+	return -EINVAL;
+    }
 
+    ret = simtemp_timer_reconfigure(nxp_dev, -1, mode);
 
+    return ret ? ret : count;   //Return number of bytes processed.
+}
 
 // ----------  Syfs Macros  ---------------
 // Static definitions of attributes of sysfs.
@@ -576,6 +2130,13 @@ static DEVICE_ATTR_RW(sampling_ms);	//Read/Write attributes for: 'sampling_ms_sh
 static DEVICE_ATTR_RW(threshold_mC);	//Read/Write attributes for: 'threshold_mC_show' (Read) and 'threshold_mC_store' (Wtite) through 'dev_attr_threshold_mC' variable.
 static DEVICE_ATTR_RO(stats);		//Read Only attributes for: 'stats_show' (Read Only) through 'dev_attr_stats' variable
 static DEVICE_ATTR_WO(clear_alert);	//Read Only attributes for: 'clear_alert_store' through 'dev_attr_clear_alert' variable
+static DEVICE_ATTR_RW(levels);		//Read/Write attributes for: 'levels_show' and 'levels_store' through 'dev_attr_levels' variable
+static DEVICE_ATTR_RW(always_on);	//Read/Write attributes for: 'always_on_show' and 'always_on_store' through 'dev_attr_always_on' variable
+static DEVICE_ATTR_RW(timer_slack_ns);	//Read/Write attributes for: 'timer_slack_ns_show' and 'timer_slack_ns_store'
+static DEVICE_ATTR_RW(timer_mode);	//Read/Write attributes for: 'timer_mode_show' and 'timer_mode_store'
+static DEVICE_ATTR_RW(producer_cpus);	//Read/Write attributes for: 'producer_cpus_show' and 'producer_cpus_store'
+static DEVICE_ATTR_RW(history_len);	//Read/Write attributes for: 'history_len_show' and 'history_len_store'
+static BIN_ATTR_RO(stats_bin, sizeof(struct simtemp_stats));	//Binary Read Only attribute: 'stats_bin_read' through 'bin_attr_stats_bin'
 
 // ------- Syfs Control List Driver ----------------
 //  .attrs 'struct attribute_group' contains all Control Files of Syfs
@@ -594,16 +2155,30 @@ static struct attribute *nxp_simtemp_attrs[]=	//Definition of attributes group
 	&dev_attr_threshold_mC.attr,	// Pointer to structure threshold_mC that contains the 'reading (_show)' and 'writing (_store)' functions.
 	&dev_attr_stats.attr,		// Pointer to structure stats that contains 'only reading (_stats)' function.
 	&dev_attr_clear_alert.attr,	// Pointer to structure clear_alert
+	&dev_attr_levels.attr,		// Pointer to structure levels (threshold table)
+	&dev_attr_always_on.attr,	// Pointer to structure always_on (Lazy Producer override)
+	&dev_attr_timer_slack_ns.attr,	// Pointer to structure timer_slack_ns
+	&dev_attr_timer_mode.attr,	// Pointer to structure timer_mode
+	&dev_attr_producer_cpus.attr,	// Pointer to structure producer_cpus
+	&dev_attr_history_len.attr,	// Pointer to structure history_len (history window)
 	NULL,				// Null Pointer to indicate the final of list. (sentinel)
 
 };
 
 
 
+// [Kernel] Binary attributes: fixed size records read with pread()
+static struct bin_attribute *nxp_simtemp_bin_attrs[] =
+{
+	&bin_attr_stats_bin,		// Pointer to structure stats_bin (struct simtemp_stats)
+	NULL,
+};
+
 // [Kernel] Attrbutes Group for registration of Control Files in Subsystem Sysfs of Devices for Driver.
 static const struct attribute_group nxp_simtemp_attr_group =
 {
     .attrs = nxp_simtemp_attrs, //Pointer Array coming from 'static struct attribute'
+    .bin_attrs = nxp_simtemp_bin_attrs, //Binary attributes (statistics snapshot)
 
 };
 
@@ -618,8 +2193,10 @@ static int nxp_simtemp_probe(struct platform_device *pdev)
     printk(KERN_INFO "Debug 0 Initializes Driver probe() function\n");
     //Creation of *nxp_dev for the first time 
     struct nxp_simtemp_dev *nxp_dev;   //Pointer to Global Structure 
+    struct simtemp_config *cfg;	//Initial Configuration Snapshot, filled from DT
     int ret;
     u32 value;
+    const char *timer_mode;	//DT 'timer-mode' string
 
     
     //New Local Pointer *dev
@@ -628,19 +2205,35 @@ static int nxp_simtemp_probe(struct platform_device *pdev)
     dev_info(dev,"Debug 1 Start\n");
 
     //Memory Allocation: Allocates and clean memory for structure nxp_simtemp_dev.
-    nxp_dev = devm_kzalloc(dev, sizeof(*nxp_dev), GFP_KERNEL);	  //Allocate
+    //Not devm: open files may outlive remove(), the structure is reference counted (simtemp_dev_put)
+    nxp_dev = kzalloc(sizeof(*nxp_dev), GFP_KERNEL);	  //Allocate
     if (!nxp_dev)
     {
 	dev_err(dev, "Debug 2 Memory allocation failed\n");
-	//kfree(nxp_dev);//Liberacion manual de memoria
 	return -ENOMEM; //Without Memory
     }
+    kref_init(&nxp_dev->ref);
+
+    //Reference of probe(): dropped after remove() or on any error below (snapshot and window are freed with it)
+    ret = devm_add_action_or_reset(dev, simtemp_dev_put, nxp_dev);
+    if (ret)
+    {
+	return ret;
+    }
     dev_info(dev,"Debug 3 Memoria allocated and valid\n");
     
     // Creation of Pointer Persistent *nxp_dev within 'platform_device *pdev'
     platform_set_drvdata(pdev, nxp_dev); //[kernel] Saves the pointer used in nxp_simtemp_read(), nxp_simtemp_poll(), simtemp_timer_callback() and sampling_ms_show()	 
 
     dev_info(dev,"Debug 4 Driver Data Set\n");
+
+    //Initial Configuration Snapshot: published before any reader or producer exists, freed with the device
+    cfg = kzalloc(sizeof(*cfg), GFP_KERNEL);
+    if (!cfg)
+    {
+	return -ENOMEM;
+    }
+    RCU_INIT_POINTER(nxp_dev->cfg, cfg);
     
     //----------   DT section	----------------
     //-------Searching and writing of 'sampling_ms' in DT------
@@ -649,15 +2242,16 @@ static int nxp_simtemp_probe(struct platform_device *pdev)
     if(ret)
     {
 	dev_warn(&pdev->dev, "Sampling period not set in DT, using default (100ms)\n");
-	nxp_dev->sampling_ms =100;
+	cfg->sampling_ms =100;
 
     }
 
     else
     {
-	nxp_dev->sampling_ms = (s32)value;
+	cfg->sampling_ms = (s32)value;
 
     }
+    cfg->period_ns = ms_to_ktime(cfg->sampling_ms);
 
     //-------Searching and writing of 'threshold_mC' in DT------
     ret = of_property_read_u32(pdev->dev.of_node, "threshold-mC", &value);
@@ -665,21 +2259,37 @@ static int nxp_simtemp_probe(struct platform_device *pdev)
     if(ret)
     {
 	dev_warn(&pdev->dev, "Threshold not used in DT, using default (4500mC)\n");
-	nxp_dev->threshold_mC = 4500; 
+	value = 4500; 
 
     }
 
-    else
-    {
+    //-------Threshold table: 'threshold-levels-mC' or the single 'threshold-mC' level------
+    simtemp_levels_parse_dt(cfg, dev, (s32)value);
 
-	nxp_dev->threshold_mC = (s32)value;
+    //-------'always-on': the producer runs without readers (default: only while /dev/simtemp is open)------
+    nxp_dev->always_on = of_property_read_bool(pdev->dev.of_node, "always-on");
+
+    //-------'timer-slack-ns' and 'timer-mode' ("relative" or "aligned")------
+    if (!of_property_read_u32(pdev->dev.of_node, "timer-slack-ns", &value))
+    {
+	cfg->slack_ns = min_t(u64, value, ktime_to_ns(cfg->period_ns));
+    }
 
+    if (!of_property_read_string(pdev->dev.of_node, "timer-mode", &timer_mode) && !strcmp(timer_mode, "aligned"))
+    {
+	cfg->timer_mode = SIMTEMP_TIMER_ALIGNED;
     }
+
+    //-------'producer-cpus': CPUs of the hrtimer callback (default: not pinned)------
+    simtemp_producer_parse_dt(nxp_dev, dev);
+    nxp_dev->producer_cpu = -1;
     //--------end of DT configuration
     
     //Initializes primitives for spinlock and wait_queue.
     spin_lock_init(&nxp_dev->lock);	//Initialize spinlock [Kernel Function]
     init_waitqueue_head(&nxp_dev->wq);	//Initialize waiting queue [Kernel Function]
+    INIT_LIST_HEAD(&nxp_dev->files);	//Initialize list of open files [Kernel Function]
+    mutex_init(&nxp_dev->ctl_lock);	//Initialize control lock of the producer [Kernel Function]
 
     dev_info(dev,"Debug 5 Primitives intialized\n");
 
@@ -689,7 +2299,18 @@ static int nxp_simtemp_probe(struct platform_device *pdev)
     //Initializes Ring Buffer
     simtemp_buffer_init(&nxp_dev->rb); //Buffer initialized
 
-    //Producer start: hrtimer_init() and hrtimer_start() are initialized.
+    //History Window: DT 'history-len' samples kept for non-destructive queries (default SIMTEMP_HISTORY_DEFAULT, 0 disables)
+    if (of_property_read_u32(pdev->dev.of_node, "history-len", &value))
+    {
+	value = SIMTEMP_HISTORY_DEFAULT;
+    }
+    ret = simtemp_history_resize(nxp_dev, min_t(u32, value, SIMTEMP_HISTORY_MAX));
+    if (ret)
+    {
+	return ret;
+    }
+
+    //Producer: hrtimer_init() only. hrtimer_start() is performed by the first open() (or 'always_on').
     //Initialize the producer Timer
     simtemp_timer_setup(nxp_dev);
 
@@ -703,9 +2324,25 @@ static int nxp_simtemp_probe(struct platform_device *pdev)
     //Transfer Channel of Binary Data between Kernel and User Space
     //Register of Character Device cointauned in 'mdev'
     nxp_dev->mdev.minor = MISC_DYNAMIC_MINOR; // Asks to Kernel for a lower available number, maybe 0.
-    nxp_dev->mdev.name = "simtemp";	      //File Name in /dev/
+    //Instance number: the first one keeps /dev/simtemp, the next ones are /dev/simtemp<n>
+    nxp_dev->index = ida_alloc(&simtemp_ida, GFP_KERNEL);
+    if (nxp_dev->index < 0)
+    {
+	return nxp_dev->index;
+    }
+
+    nxp_dev->mdev.name = nxp_dev->index ? devm_kasprintf(dev, GFP_KERNEL, "simtemp%d", nxp_dev->index) : "simtemp";	//File Name in /dev/
+    if (!nxp_dev->mdev.name)
+    {
+	ida_free(&simtemp_ida, nxp_dev->index);
+	return -ENOMEM;
+    }
     // Allocate the Function Operation Table 'nxp_simtemp_fops' to Files System of Kernel (/dev/simtemp)
     nxp_dev->mdev.fops = &nxp_simtemp_fops;   
+    nxp_dev->mdev.parent = dev;		      //Platform device: used for Runtime PM of the producer
+
+    //Runtime PM: the device is suspended while the producer is stopped
+    pm_runtime_enable(dev);
 
     //Register the Device Driver and /dev/simtemp is created by kernel .
     ret = misc_register(&nxp_dev->mdev); 
@@ -714,6 +2351,8 @@ static int nxp_simtemp_probe(struct platform_device *pdev)
     {
 	dev_err(dev, "Debug 6. Error registered miscdevice\n");
 	//kfree(nxp_dev);//Liberacion manual de memoria
+	pm_runtime_disable(dev);
+	ida_free(&simtemp_ida, nxp_dev->index);
 	return ret;
     }
     //-------------changes review---------belowwwwww
@@ -730,11 +2369,22 @@ static int nxp_simtemp_probe(struct platform_device *pdev)
     {
 	dev_err(dev, "Debug 7 Error registered sysfs group\n");
 	misc_deregister(&nxp_dev->mdev);
+	pm_runtime_disable(dev);
+	ida_free(&simtemp_ida, nxp_dev->index);
 
 	return ret;
 
     }
     dev_info(dev, "Debug 8 Device and Syfs registered successfully\n");
+
+    //'always-on' from DT: the producer starts now instead of waiting for the first reader
+    //A failure is not fatal: the override stays set and the first open() retries (and reports the error)
+    mutex_lock(&nxp_dev->ctl_lock);
+    if (simtemp_producer_update(nxp_dev))
+    {
+	dev_warn(dev, "always-on producer not started, waiting for the first reader\n");
+    }
+    mutex_unlock(&nxp_dev->ctl_lock);
     //dev_info(dev, "NXP SimTemp device registered at /dev/%s\n", nxp_dev->mdev.name );
     return 0;
 
@@ -749,20 +2399,24 @@ static void nxp_simtemp_remove(struct platform_device *pdev) //[Kernel] structur
     //Clean Unload [kernel]: Stops timer and desregister all
     //hrtimer_cancel(&nxp_dev->timer); //[Kernel] Stops the timer if miscdevice fails to prevents an Kernel Panic
     //misc_deregister(&nxp_dev->mdev); // [Kernel] Delete Character Device of system files durin the clean remove
-    //Memory automatically is liberated by devm_kzalloc
+    //Memory is liberated by the last reference (simtemp_dev_put): open files keep it after unbind
 
     
     if(nxp_dev)
     {
-	// Producer is stopped (hrtimer initialized in probe function)
-	hrtimer_cancel(&nxp_dev->timer); 
-
 	//*-------Sysfs Secion---------- */
 	sysfs_remove_group(&pdev->dev.kobj, &nxp_simtemp_attr_group);
   
 	  // Unregistered Interface: 
 	misc_deregister(&nxp_dev->mdev);
 
+	// Producer is stopped for good, the Runtime PM reference is released and open readers are woken (-ENODEV).
+	// The structure itself is freed by the last reference: the devm action of probe() or the last close().
+	simtemp_dev_detach(nxp_dev);
+
+	pm_runtime_disable(&pdev->dev);
+	ida_free(&simtemp_ida, nxp_dev->index);
+
 	dev_info(&pdev->dev,"NXP SimTemp device unregistered. \n");
     }
       
@@ -776,6 +2430,12 @@ static void nxp_simtemp_remove(struct platform_device *pdev) //[Kernel] structur
 static int __init simtemp_runtime_init(void)
 {
    int ret;
+   unsigned int i;
+
+    if (nr_devices < 1 || nr_devices > SIMTEMP_MAX_DEVICES) {
+	printk(KERN_ERR "NXP SimTemp: nr_devices must be 1..%d\n", SIMTEMP_MAX_DEVICES);
+	return -EINVAL;
+    }
     
     // 1. Register platform driver (for probe() is ready)
     ret = platform_driver_register(&nxp_simtemp_driver);
@@ -784,27 +2444,37 @@ static int __init simtemp_runtime_init(void)
 	return ret;
     }
 
-    // 2. Memory allocation for Virtual Device.
-    simtemp_pdev = platform_device_alloc("nxp_simtemp", PLATFORM_DEVID_NONE);
-    if (!simtemp_pdev) {
-	printk(KERN_ERR "NXP SimTemp: Failed to allocate platform device.\n");
-	platform_driver_unregister(&nxp_simtemp_driver);
-	return -ENOMEM;
-    }
+    for (i = 0; i < nr_devices; i++) {
+	// 2. Memory allocation for Virtual Device. The first one keeps the name "nxp_simtemp" (sysfs path used by the CLI)
+	simtemp_pdevs[i] = platform_device_alloc("nxp_simtemp", i ? (int)i : PLATFORM_DEVID_NONE);
+	if (!simtemp_pdevs[i]) {
+	    printk(KERN_ERR "NXP SimTemp: Failed to allocate platform device.\n");
+	    ret = -ENOMEM;
+	    goto err_devices;
+	}
     
-    // 3. Add virtual device (forces to call to nxp_simtemp_probe())
-    ret = platform_device_add(simtemp_pdev);
-    if (ret) {
-	printk(KERN_ERR "NXP SimTemp: Failed to add virtual platform device. Ret: %d\n", ret);
-	platform_driver_unregister(&nxp_simtemp_driver);
-	platform_device_put(simtemp_pdev);
-	return ret;
+	// 3. Add virtual device (forces to call to nxp_simtemp_probe())
+	ret = platform_device_add(simtemp_pdevs[i]);
+	if (ret) {
+	    printk(KERN_ERR "NXP SimTemp: Failed to add virtual platform device. Ret: %d\n", ret);
+	    platform_device_put(simtemp_pdevs[i]);
+	    simtemp_pdevs[i] = NULL;
+	    goto err_devices;
+	}
     }
 
     // If call to nxp_simtemp_probe() was successful:
-    printk(KERN_INFO "NXP SimTemp: Virtual device and driver registered successfully.\n");
+    printk(KERN_INFO "NXP SimTemp: %u virtual device(s) and driver registered successfully.\n", nr_devices);
     return 0;
 
+err_devices:
+    while (i--) {
+	platform_device_unregister(simtemp_pdevs[i]);
+	simtemp_pdevs[i] = NULL;
+    }
+    platform_driver_unregister(&nxp_simtemp_driver);
+    return ret;
+
     
 
 }
@@ -812,8 +2482,13 @@ static int __init simtemp_runtime_init(void)
 
 static void __exit simtemp_runtime_exit(void)
 {
+    unsigned int i;
+
     //For Clean Unload. Cleaning in inverse order.
-    platform_device_unregister(simtemp_pdev);	       //
+    for (i = nr_devices; i-- > 0; )
+    {
+	platform_device_unregister(simtemp_pdevs[i]);	       //
+    }
     platform_driver_unregister(&nxp_simtemp_driver);   //
     printk(KERN_INFO "NXP SimTemp: Module unloaded\n");
 
@@ -821,6 +2496,13 @@ static void __exit simtemp_runtime_exit(void)
 
 
 
+//-------------------KUnit Suites ('make kunit'): same translation unit, so the tests reach the static functions-------
+#ifdef SIMTEMP_KUNIT_TEST
+#include "nxp_simtemp_kunit.c"
+#endif
+
+
+
 //-------------------Macros (always placed al the end of the code for Linux )-------------------------------
 module_init(simtemp_runtime_init); // [Kernel] Macro for indicate to kernel what funtion mus be called when the modulo is load nxp_simtemp_init
 module_exit(simtemp_runtime_exit); // [Kernel] Macro for indicate to kernel what funtion mus be called when the modulo is load nxp_simtemp_init
\ No newline at end of file
@@ -40,6 +40,20 @@
 #include <linux/poll.h>             //Polling interface for handling of I/O based in events.
 #include <linux/random.h>           //Generation of random numbers RNG
 #include <linux/time.h>             //Time measurement and timestamps
+#include <linux/list.h>             //Linked list of open files (per-file contexts) attached to the device
+#include <linux/mutex.h>            //Sleeping lock for control paths (open/release/sysfs) that start or stop the producer
+#include <linux/pm_runtime.h>       //Runtime Power Management: the device is active only while the producer runs
+#include <linux/idr.h>              //IDA allocator: index of each instance (/dev/simtemp, /dev/simtemp1, ...)
+#include <linux/kref.h>             //Reference count of the Global Structure: open files keep it alive after remove()
+#include <linux/percpu.h>           //Per-CPU time of the last producer wakeup (coalescing metric)
+#include <linux/math64.h>           //64-bit divisions (period alignment, jitter average) portable to 32-bit CPUs
+#include <linux/rcupdate.h>         //RCU: configuration snapshot read by the producer without locks
+#include <linux/cpumask.h>          //CPU affinity of the producer (sysfs 'producer_cpus', DT 'producer-cpus')
+#include <linux/smp.h>              //smp_call_function_single(): the pinned hrtimer is armed from the target CPU
+#include <linux/mm.h>               //kvcalloc()/kvfree(): history window, up to SIMTEMP_HISTORY_MAX samples
+#include <linux/log2.h>             //roundup_pow_of_two(): length of the history window
+
+#include "nxp_simtemp_ioctl.h"      //User/Kernel Contract: struct simtemp_sample, flags and ioctl commands
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Daniel Miranda");
@@ -47,20 +61,21 @@ MODULE_DESCRIPTION("NXP SimpTemp");
 MODULE_VERSION("1.0");
 
 #define RING_BUFFER_SIZE    32          //Size of buffer
-#define SAMPLE_AVAILABLE    (1<<0)      //Bit 0 for __u32 flags in struct simtemp_sample
-#define TRESHOLD_CROSSED    (1<<1)      //Bit 1 for __u32 flags in struct simtemp_sample
-
+#define SIMTEMP_READ_BATCH  8           //Samples extracted per critical section by read() (stack buffer)
+#define SIMTEMP_MAX_DEVICES 16          //Maximum instances created by the module parameter 'nr_devices'
+#define SIMTEMP_COALESCE_NS 50000       //Producers firing on the same CPU within 50 us share one wakeup
+#define SIMTEMP_HISTORY_DEFAULT 256     //Samples kept by the history window without 'history-len' in DT
+#define SIMTEMP_HISTORY_MAX     65536   //Largest 'history_len' (1 MiB of samples)
 
-//--------------------------Data Structure---------------------------------------
-//----------------- Data Structure: Transferred Data  --------------------//
-struct simtemp_sample       // Data Structure Contract [Logic]: Defines transferred data between kernel and user space. Inside the kernel and performed by user space
+//Timer Modes of the producer (sysfs 'timer_mode', DT 'timer-mode')
+enum simtemp_timer_mode
 {
-    u64 timestamp_ns;       //Sample in nanoseconds: Calculates the accuracy of sampling and jitter from User Space
-    s32 temp_mC;            //Sample in millidegrees: Represents values in float point without float point arithmetic
-    u32 flags;              //Sample status: Notificates to applications if NXP_SAMPLE_AVAILABLE or NXP_THRESHOLD_CROSSED   
+    SIMTEMP_TIMER_RELATIVE = 0,         //Period counted from the start of the producer (HRTIMER_MODE_REL)
+    SIMTEMP_TIMER_ALIGNED,              //Expiries phase-locked to multiples of the period on CLOCK_MONOTONIC (HRTIMER_MODE_ABS)
+};
 
-}
-__attribute__((packed));    //Avoid memory padding. Recomended by NXP Challenge to keep the same size for Kernel/User
+//--------------------------Data Structure---------------------------------------
+//struct simtemp_sample (Transferred Data) is defined in nxp_simtemp_ioctl.h, shared with User Space.
 
 //---------------- Data Structure:  Ring Buffer  ------------------------------------//
 struct simtemp_ring_buffer  //Structure for Storage [Logic]: Defines the architecture that stores and manipulates the data of "simtemp_sample[]""
@@ -69,9 +84,50 @@ struct simtemp_ring_buffer  //Structure for Storage [Logic]: Defines the archite
     size_t head;                                    //Writing Index: Used by producer "hrtimer" that puts the next sample 
     size_t tail;                                    //Reading Index: Used by consumer "read" of User Space that takes the next sample.
     u32 count;                                      //Counter to determine the validate samples in the buffer: ((count == 0) or (count == RING_BUFFER_SIZE)). 
+    u64 seq;                                        //Sequence of the next sample to be pushed. Sample 'n' lives in buffer[n % RING_BUFFER_SIZE] while n >= seq - RING_BUFFER_SIZE
 
 };
 
+//---------------- Data Structure:  History Window  ------------------------------------//
+//Last 'len' samples produced, never consumed: read() takes samples from the ring, SIMTEMP_IOC_GET_HISTORY copies them from here.
+//Valid samples: [max(start, seq - min(seq, len)), seq), see simtemp_history_oldest().
+struct simtemp_history_window
+{
+    struct simtemp_sample       *buf;       //kvcalloc'd array of 'len' samples (NULL when the window is disabled)
+    u32                         len;        //Power of two (0: disabled). Sample 'n' lives in buf[n & (len - 1)]
+    u64                         seq;        //Sequence of the next sample
+    u64                         start;      //First sequence kept by the last resize: a grown or re-enabled window has empty slots before it
+};
+
+//------------- Data Structure:  Threshold Level State   ----------------------------------------
+struct simtemp_level_state  //One entry of the threshold table [Logic]: producer state (the thresholds live in struct simtemp_config)
+{
+    u32                         alerts;         //Pending alerts of this level: incremented by the producer, decremented by read(), reset by clear_alert
+    u64                         alerts_total;   //Alerts raised by this level since probe: never decremented nor reset (stats counter)
+    bool                        active;         //Level currently exceeded (hysteresis state)
+};
+
+//------------- Data Structure:  Configuration Snapshot   ----------------------------------------
+//Published through RCU in dev->cfg. A published snapshot is never modified: writers (sysfs/ioctl, serialized by
+//ctl_lock) publish a modified copy and the hrtimer callback picks it up at its next expiry without taking any lock.
+struct simtemp_config
+{
+    s32                         sampling_ms;    //Period in milliseconds (sysfs 'sampling_ms')
+    ktime_t                     period_ns;      //Period in nanoseconds for the hrtimer
+    u64                         slack_ns;       //Slack given to hrtimer_start_range_ns(): the expiry may be delayed up to slack_ns to share a wakeup
+    enum simtemp_timer_mode     timer_mode;     //Relative or period aligned expiries
+
+    u32                         nr_levels;      //Levels in use
+    u32                         levels_gen;     //Incremented when the table is replaced: the producer restarts the hysteresis state
+    struct
+    {
+	s32                     threshold_mC;   //Alert threshold of the level (level 0 is the sysfs 'threshold_mC')
+	u32                     hysteresis_mC;  //Release point is threshold_mC - hysteresis_mC
+    } levels[SIMTEMP_MAX_LEVELS];
+
+    struct rcu_head             rcu;            //Deferred free of the replaced snapshot (kfree_rcu)
+};
+
 //------------- Data Structure:  Driver (nxp_simtemp)   ----------------------------------------
 struct nxp_simtemp_dev      //Global Structure [Logic]: Contains the configuration values, functionalities and interfaces of Driver reside
 {    
@@ -80,30 +136,77 @@ struct nxp_simtemp_dev      //Global Structure [Logic]: Contains the configurati
     spinlock_t                  lock;       //Structure of concurrency [Kernel]: Protection of storage (shared resources) of interrupts and simultaneous access 
 
     struct hrtimer              timer;      //Structure of timer [Kernel]: Data Producer to initializes the High Resolution
-    ktime_t                     period_ns;  //Structure of Time Type [Kernel]: Data Times with nanosecond precision
+    struct simtemp_config __rcu *cfg;       //Configuration Snapshot [Logic]: period, slack, timer mode and threshold table
 
     struct simtemp_ring_buffer  rb;         //Structure of storage [Logic]: Circular buffer (Data storage)
+    struct simtemp_history_window hist;     //History window (protected by 'lock'): non-destructive queries of the recent samples
 
-    //Configuration of variables for sysfs to export information from Kernel Subsystems to space user
-    s32                         threshold_mC;   //Temperature
-    s32                         sampling_ms;    //Period
+    //State of the threshold table (protected by 'lock')
+    struct simtemp_level_state  levels[SIMTEMP_MAX_LEVELS];    //Alerts and hysteresis state of each level
+    u32                         levels_gen;     //cfg->levels_gen of the table the state belongs to
 
     //Configuration of variables for statistics
-    u32                         alerts_count;   //Variable for Diagnostic functions as Logic Counter (stats_show) that indicates how many data crossed a critical treshold
+    u32                         alerts_count;   //Variable for Diagnostic functions as Logic Counter (stats_show) that indicates how many data crossed any threshold level
     u32                         updates_count;  //Variable for Diagnostic functions as Logic Counter that indicates how many data was produced.
+    u64                         overflows;      //Samples overwritten in the ring before the shared queue consumed them
+
+    struct list_head            files;          //Open files (struct simtemp_file) protected by 'lock'. Walked by the producer to wake filtered readers
 
+    //Lazy Producer: the hrtimer only runs while readers are attached (or 'always_on' is set)
+    struct mutex                ctl_lock;       //Serializes start/stop of the producer. Process context only (never taken by the hrtimer)
+    u32                         users;          //Open files of /dev/simtemp (reference count of the producer)
+    bool                        always_on;      //sysfs/DT override: keep the producer running without readers (history use cases)
+    bool                        running;        //hrtimer armed and runtime PM reference held
+
+    int                         index;          //Instance number (0: /dev/simtemp, n: /dev/simtemp<n>)
+
+    //Lifetime: probe() and every open file hold a reference, the last simtemp_dev_put() frees the structure
+    struct kref                 ref;
+    bool                        dead;           //remove() ran (set under ctl_lock): readers get -ENODEV, the producer is never restarted
+
+    //CPU Affinity of the producer (protected by ctl_lock)
+    struct cpumask              producer_cpus;  //CPUs allowed to run the hrtimer callback. Empty: not pinned (CPU that arms it)
+    int                         producer_cpu;   //CPU of the last callback (stats), -1 before the first sample
+    u64                         cfg_updates;    //Configuration snapshots published since probe (diagnostic)
+
+    //Timer Metrics (protected by 'lock')
+    u64                         timer_fires;    //Callbacks executed
+    u64                         timer_coalesced;//Callbacks that ran in the same wakeup as another simtemp producer on that CPU
+    u64                         jitter_last_ns; //Delay of the last callback from its soft expiry
+    u64                         jitter_max_ns;  //Worst delay observed
+    u64                         jitter_sum_ns;  //Sum of delays (average = jitter_sum_ns / timer_fires)
+
+};
+
+//------------- Data Structure:  Open File (Per-file Context)   ----------------------------------------
+struct simtemp_file         //Per-file State [Logic]: Created in open(), stored in file->private_data and released in release()
+{
+    struct nxp_simtemp_dev      *dev;       //Back pointer to the Global Structure
+    struct list_head            node;       //Entry in dev->files
+    wait_queue_head_t           wq;         //Per-file Wait Queue: filtered and broadcast readers only sleep here, so they are woken only for their samples
+
+    u32                         delivery;   //SIMTEMP_DELIVERY_SHARED (dev->wq, exclusive wakeups) or SIMTEMP_DELIVERY_BROADCAST (own cursor)
+    struct simtemp_filter       filter;     //Filter installed through SIMTEMP_IOC_SET_FILTER (mode == 0: no filter)
+    u64                         cursor;     //Sequence of the next sample to evaluate in the ring (filtered and broadcast files only)
+    bool                        ready;      //Sample at 'cursor' was accepted by the filter and is waiting for read()
+    bool                        has_last;   //'last_mC' is valid (SIMTEMP_FILTER_DELTA)
+    s32                         last_mC;    //Last delivered temperature (SIMTEMP_FILTER_DELTA)
+    u32                         nth;        //Samples seen by the decimation stage (SIMTEMP_FILTER_EVERY_N)
+    u32                         level_mask; //Levels this file subscribes to (POLLPRI and SIMTEMP_FILTER_ALERT_ONLY). All levels by default
+    u64                         dropped;    //Samples overwritten before this file could evaluate them
 };
 
 //--------------------  Function Prototypes  ------------------------------------------
 //-----Function Prototypes: Driver Functions: Define the Life Cycle abd the Interface of Platform Driver------------------------
 
-static struct platform_device *simtemp_pdev;
+static struct platform_device *simtemp_pdevs[SIMTEMP_MAX_DEVICES];    //Virtual devices created by the module (nr_devices)
 
 //---File Operations/Input-Output Functions----
 static int nxp_simtemp_open(struct inode *inode, struct file *file);                                //Function Prototype performed once when user space opens the file
 static int nxp_simtemp_release(struct inode *inode, struct file *file);                             //Function Prototype performed when user space calls to close() or when the process end.
 static ssize_t nxp_simtemp_read(struct file *file, char __user *buf, size_t count, loff_t *ppos);   //Function Prototype performed when User Space calls to read().  
 static __poll_t nxp_simtemp_poll(struct file *file, struct poll_table_struct *wait);                //Function Prototype performed when User Space calls to poll(), select() or epoll().
+static long nxp_simtemp_ioctl(struct file *file, unsigned int cmd, unsigned long arg);               //Function Prototype performed when User Space calls to ioctl().
 //--- Driver Life Cycle Functions---
 static void nxp_simtemp_remove(struct platform_device *pdev);                                       //Function Prototype [Kernel] structure from "platform_device.h"
 static int nxp_simtemp_probe(struct platform_device *pdev);  
@@ -113,10 +216,24 @@ static int nxp_simtemp_probe(struct platform_device *pdev);
 static ssize_t sampling_ms_show(struct device *dev, struct device_attribute *attr, char *buf);
 static ssize_t threshold_mC_show(struct device *dev, struct device_attribute *attr, char *buf);
 static ssize_t stats_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t levels_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t always_on_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t timer_slack_ns_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t timer_mode_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t producer_cpus_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t history_len_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t stats_bin_read(struct file *filp, struct kobject *kobj, const struct bin_attribute *attr,
+                              char *buf, loff_t off, size_t count);    //Binary attribute: struct simtemp_stats
 //--- Writing Functions: _store  ---
 static ssize_t sampling_ms_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
 static ssize_t threshold_mC_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
 static ssize_t clear_alert_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t levels_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t always_on_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t timer_slack_ns_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t timer_mode_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t producer_cpus_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t history_len_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
 
 //-----Function Prototypes: Module Lifecycle Functions: Entry and exit points for load and unload of Driver.
 static int __init simtemp_runtime_init(void);
@@ -125,6 +242,34 @@ static void __exit simtemp_runtime_exit(void);
 //----- Function Prototypes: Producer Control (Timer and Event Logic): Init, Mantain and operate the sampling ------------------
 enum hrtimer_restart simtemp_timer_callback(struct hrtimer *timer);
 static void simtemp_timer_setup(struct nxp_simtemp_dev *dev); //Este prototipo se declaro despues de la declaracion de la estructura.
+static int simtemp_producer_update(struct nxp_simtemp_dev *dev);    //Starts/stops the hrtimer from 'users' and 'always_on' (ctl_lock held)
+
+//----- Function Prototypes: Device Lifetime: the Global Structure outlives remove() while files are open.
+static void simtemp_dev_release(struct kref *ref);                      //Last reference: frees snapshot, window and structure
+static void simtemp_dev_put(void *data);                                //Drops one reference (also the devm action of probe)
+static void simtemp_dev_detach(struct nxp_simtemp_dev *dev);            //remove(): stops the producer and wakes every reader
+static void simtemp_timer_arm(struct nxp_simtemp_dev *dev);         //hrtimer_start_range_ns() with the slack and the timer mode of the device
+static void simtemp_timer_forward(struct hrtimer *timer, const struct simtemp_config *cfg, ktime_t now);   //Next expiry from the current snapshot
+
+//----- Function Prototypes: CPU Affinity of the producer: the hrtimer is armed pinned on the selected CPU (ctl_lock held).
+static int simtemp_producer_pick_cpu(struct nxp_simtemp_dev *dev);
+static void simtemp_timer_start(struct nxp_simtemp_dev *dev, ktime_t expires, u64 slack_ns, enum hrtimer_mode mode);
+static void simtemp_timer_start_local(void *data);                      //Runs on the target CPU (IPI)
+static void simtemp_producer_migrate(struct nxp_simtemp_dev *dev);      //Re-arms a running producer on the new CPU keeping its expiry
+static void simtemp_producer_parse_dt(struct nxp_simtemp_dev *dev, struct device *pdev_dev);
+
+//----- Function Prototypes: Configuration Snapshot (RCU): Writers copy, modify and publish. ctl_lock held.
+static struct simtemp_config *simtemp_config_edit(struct nxp_simtemp_dev *dev);
+static void simtemp_config_publish(struct nxp_simtemp_dev *dev, struct simtemp_config *cfg);
+static void simtemp_config_free(void *data);                            //Frees the last snapshot (last reference of the device)
+static int simtemp_timer_reconfigure(struct nxp_simtemp_dev *dev, s64 slack_ns, int mode);  //Publishes a new slack and/or timer mode
+
+//----- Function Prototypes: Threshold Levels: Hysteresis evaluation, alert accounting and atomic update of the table.
+static u32 simtemp_levels_update(struct nxp_simtemp_dev *dev, const struct simtemp_config *cfg, s32 temp_mC);
+static u32 simtemp_levels_pending(struct nxp_simtemp_dev *dev);
+static void simtemp_levels_ack(struct nxp_simtemp_dev *dev, u32 sample_flags);
+static int simtemp_levels_apply(struct nxp_simtemp_dev *dev, const struct simtemp_levels *table);
+static void simtemp_levels_parse_dt(struct simtemp_config *cfg, struct device *pdev_dev, s32 threshold_mC);
 
 //----- Function Prototypes: Ring Buffer functions (store management): Manage the Data structure used for the communication between producer and consumer.
 static bool simtemp_buffer_is_empty(struct nxp_simtemp_dev *dev);
@@ -132,5 +277,23 @@ static void simtemp_buffer_push(struct nxp_simtemp_dev *dev, const struct simtem
 static bool simtemp_buffer_pop(struct nxp_simtemp_dev *dev, struct simtemp_sample *sample);
 static void simtemp_buffer_init(struct simtemp_ring_buffer *rb);
 
+//----- Function Prototypes: History Window: last 'history_len' samples, copied out without consuming them.
+static void simtemp_history_push(struct nxp_simtemp_dev *dev, const struct simtemp_sample *sample);
+static int simtemp_history_resize(struct nxp_simtemp_dev *dev, u32 len);
+static u64 simtemp_history_oldest(const struct nxp_simtemp_dev *dev);   //First valid sequence of the window
+static long simtemp_history_query(struct nxp_simtemp_dev *dev, struct simtemp_history __user *uarg);
+static void simtemp_history_free(void *data);                           //Frees the window (last reference of the device)
+
+//----- Function Prototypes: Per-file Filters: Evaluated over the cursor of each filtered file (read, poll and producer paths).
+static bool simtemp_filter_match(struct simtemp_file *ctx, const struct simtemp_sample *sample);
+static bool simtemp_filter_advance(struct nxp_simtemp_dev *dev, struct simtemp_file *ctx);
+static bool simtemp_file_ready(struct nxp_simtemp_dev *dev, struct simtemp_file *ctx);
+static bool simtemp_file_own_cursor(const struct simtemp_file *ctx);  //Filtered or broadcast: reads the ring through ctx->cursor
+static ssize_t simtemp_read_cursor(struct file *file, struct simtemp_file *ctx, char __user *buf, size_t count);
+static void simtemp_wake_readers(struct nxp_simtemp_dev *dev);
+
+//----- Function Prototypes: Statistics Snapshot: struct simtemp_stats for stats_bin and SIMTEMP_IOC_GET_STATS.
+static void simtemp_stats_snapshot(struct nxp_simtemp_dev *dev, struct simtemp_stats *st);
+
 
 #endif // End of _NXP_SIMTEMP_H_
\ No newline at end of file
@@ -0,0 +1,160 @@
+/***************************************************************************
+	Open Source License 2025 NXP Semiconductor Challenge Stage
+****************************************************************************
+* Title        : nxp_simtemp_ioctl.h
+* Description  : User/Kernel Contract of /dev/simtemp (sample layout and ioctl commands)
+*
+* Environment  : C Language (Kernel and User Space)
+*
+* Responsible  : Daniel R Miranda [danielrmirandacortes@gmail.com]
+*
+* Guidelines   : Linux Kernel Coding Style
+*
+*
+* This header is shared by nxp_simtemp.c and by User Space consumers, so it only
+* uses the exported types from <linux/types.h> (__u32, __s32, __u64).
+*
+****************************************************************************
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* * * * * * * * * * * Header Files *   *   *   *   *   *   *   *   *   *   *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _NXP_SIMTEMP_IOCTL_H_
+#define _NXP_SIMTEMP_IOCTL_H_
+
+#include <linux/ioctl.h>            //Macros _IOR/_IOW/_IOWR to build the ioctl command numbers
+#include <linux/types.h>            //Exported Data Types (__u32, __s32, __u64) valid in Kernel and User Space
+
+#define SAMPLE_AVAILABLE    (1<<0)      //Bit 0 for __u32 flags in struct simtemp_sample
+#define TRESHOLD_CROSSED    (1<<1)      //Bit 1 for __u32 flags in struct simtemp_sample: at least one threshold level exceeded
+
+//----------------- Threshold Levels (warning, critical, shutdown, ...)  --------------------//
+#define SIMTEMP_MAX_LEVELS          4           //Size of the fixed table of threshold levels
+#define SIMTEMP_LEVEL_SHIFT         8           //Bits 8..11 of flags: bitmask of the levels exceeded by the sample
+#define SIMTEMP_LEVEL_FLAG(n)       (1U << (SIMTEMP_LEVEL_SHIFT + (n)))
+#define SIMTEMP_LEVEL_FLAGS(flags)  (((flags) >> SIMTEMP_LEVEL_SHIFT) & SIMTEMP_LEVELS_ALL)   //Extracts the level bitmask (bit n = level n)
+#define SIMTEMP_LEVELS_ALL          ((1U << SIMTEMP_MAX_LEVELS) - 1)
+
+
+//----------------- Data Structure: Transferred Data  --------------------//
+struct simtemp_sample       // Data Structure Contract [Logic]: Defines transferred data between kernel and user space. Inside the kernel and performed by user space
+{
+    __u64 timestamp_ns;     //Sample in nanoseconds: Calculates the accuracy of sampling and jitter from User Space
+    __s32 temp_mC;          //Sample in millidegrees: Represents values in float point without float point arithmetic
+    __u32 flags;            //Sample status: Notificates to applications if NXP_SAMPLE_AVAILABLE or NXP_THRESHOLD_CROSSED
+
+}
+__attribute__((packed));    //Avoid memory padding. Recomended by NXP Challenge to keep the same size for Kernel/User
+
+
+//----------------- Data Structure: Per-file Filter (Server Side)  --------------------//
+//Installed with SIMTEMP_IOC_SET_FILTER on one open file. Every enabled condition must pass (AND).
+//A filtered file stops sharing the queue (rb.tail) and reads the ring through its own cursor.
+#define SIMTEMP_FILTER_ALERT_ONLY   (1<<0)      //Only samples exceeding a level subscribed by this file
+#define SIMTEMP_FILTER_RANGE        (1<<1)      //Only samples with min_mC <= temp_mC <= max_mC
+#define SIMTEMP_FILTER_EVERY_N      (1<<2)      //Only one of every 'every_n' samples (decimation)
+#define SIMTEMP_FILTER_DELTA        (1<<3)      //Only samples that changed more than 'delta_mC' from the last delivered one
+#define SIMTEMP_FILTER_MASK         (SIMTEMP_FILTER_ALERT_ONLY | SIMTEMP_FILTER_RANGE | SIMTEMP_FILTER_EVERY_N | SIMTEMP_FILTER_DELTA)
+
+struct simtemp_filter
+{
+    __u32 mode;             //SIMTEMP_FILTER_* bitmask. 0 removes the filter and returns the file to the shared queue
+    __s32 min_mC;           //SIMTEMP_FILTER_RANGE: lower bound (inclusive)
+    __s32 max_mC;           //SIMTEMP_FILTER_RANGE: upper bound (inclusive)
+    __u32 every_n;          //SIMTEMP_FILTER_EVERY_N: decimation factor (>= 1)
+    __u32 delta_mC;         //SIMTEMP_FILTER_DELTA: minimum change in millidegrees
+    __u32 reserved;         //Must be 0
+};
+
+
+//----------------- Data Structure: Threshold Level Table  --------------------//
+//A level is exceeded when temp_mC > threshold_mC and stays exceeded until temp_mC <= threshold_mC - hysteresis_mC.
+struct simtemp_level
+{
+    __s32 threshold_mC;     //Alert threshold of this level in millidegrees
+    __u32 hysteresis_mC;    //Hysteresis below threshold_mC to release the level
+    __u32 alerts;           //Alert counter of this level (SIMTEMP_IOC_GET_LEVELS only, ignored when set)
+    __u32 reserved;         //Must be 0
+};
+
+struct simtemp_levels       //Whole table, applied atomically by SIMTEMP_IOC_SET_LEVELS
+{
+    __u32 count;            //Levels in use (0..SIMTEMP_MAX_LEVELS). Level 0 is the legacy threshold_mC
+    __u32 reserved;         //Must be 0
+    struct simtemp_level level[SIMTEMP_MAX_LEVELS];
+};
+
+
+//----------------- Delivery Mode (Wakeups of concurrent readers)  --------------------//
+//SHARED (default): work-sharing. The open files share one queue, each sample is delivered once and
+//the producer wakes only one blocked reader per sample (exclusive wakeup, no thundering herd).
+//BROADCAST: fan-out. This file receives every sample through its own cursor and its own Wait Queue.
+#define SIMTEMP_DELIVERY_SHARED     0
+#define SIMTEMP_DELIVERY_BROADCAST  1
+
+
+//----------------- Data Structure: Statistics Snapshot (Binary)  --------------------//
+//Same counters as the 'stats' text attribute, copied under one lock (consistent with each other).
+//Read with pread() at offset 0 of /sys/.../stats_bin (the file stays open between reads) or with SIMTEMP_IOC_GET_STATS.
+//'size' is sizeof(struct simtemp_stats) of the driver: new fields are only appended at the end.
+struct simtemp_stats
+{
+    __u32 size;             //Size of this structure as filled by the driver
+    __u32 index;            //Instance number (0: /dev/simtemp, n: /dev/simtemp<n>)
+    __u64 updates;          //Samples produced
+    __u64 overflows;        //Samples overwritten in the ring before the shared queue consumed them
+    __u64 timer_fires;      //Callbacks of the producer
+    __u64 wakeups;          //Callbacks not coalesced with another producer on the same CPU
+    __u64 jitter_last_ns;   //Delay of the last callback from its soft expiry
+    __u64 jitter_max_ns;    //Worst delay observed
+    __u64 jitter_sum_ns;    //Sum of delays (average = jitter_sum_ns / timer_fires)
+    __u64 config_updates;   //Configuration snapshots published
+    __u32 alerts;           //Alerts not acknowledged yet ('alerts' of stats)
+    __u32 readers;          //Open files of the device
+    __u32 running;          //1 while the producer runs
+    __s32 producer_cpu;     //CPU of the last callback, -1 before the first sample
+    __s32 sampling_ms;      //Sampling period
+    __s32 threshold_mC;     //Threshold of level 0 (legacy threshold_mC)
+    __u32 queued;           //Samples waiting in the shared queue
+    __u32 nr_levels;        //Levels in use
+    __u32 level_alerts[SIMTEMP_MAX_LEVELS];    //Pending alerts of each level (decremented by read(), reset by clear_alert)
+    __u64 level_alerts_total[SIMTEMP_MAX_LEVELS];  //Alerts raised by each level since probe (never decremented)
+};
+
+
+//----------------- Data Structure: History Query (Non-destructive)  --------------------//
+//The device keeps the last 'history_len' samples (sysfs/DT) besides the ring. SIMTEMP_IOC_GET_HISTORY copies
+//part of that window without consuming anything: the shared queue, the cursors and the alert counters are not touched.
+#define SIMTEMP_HISTORY_LAST        0           //The newest 'count' samples
+#define SIMTEMP_HISTORY_SINCE       1           //The oldest 'count' samples from sequence 'since_seq' on (pass back 'next_seq' to continue)
+
+//Every sample written to the window gets the next sequence number of the device. SINCE is keyed on it, not on
+//timestamp_ns: CLOCK_REALTIME may step backwards (NTP, settimeofday), the sequence never does.
+struct simtemp_history
+{
+    __u32 mode;             //SIMTEMP_HISTORY_LAST or SIMTEMP_HISTORY_SINCE
+    __u32 count;            //In: capacity of 'samples' in samples. Out: samples copied, oldest first
+    __u64 since_seq;        //SIMTEMP_HISTORY_SINCE: first sequence wanted ('next_seq' of the previous query)
+    __u64 samples;          //User pointer to struct simtemp_sample[count]
+    __u32 available;        //Out: samples held by the history window when the query started
+    __u32 lost;             //Out: samples of the range already dropped from the window (before or while copying)
+    __u64 next_seq;         //Out: sequence following the last sample copied (or the end of the window)
+};
+
+
+//--------------------------  ioctl Commands  ------------------------------------
+#define SIMTEMP_IOC_MAGIC           'S'
+
+#define SIMTEMP_IOC_SET_FILTER      _IOW(SIMTEMP_IOC_MAGIC, 1, struct simtemp_filter)   //Installs/removes the filter of this open file
+#define SIMTEMP_IOC_GET_FILTER      _IOR(SIMTEMP_IOC_MAGIC, 2, struct simtemp_filter)   //Reads back the filter of this open file
+#define SIMTEMP_IOC_SET_LEVELS      _IOW(SIMTEMP_IOC_MAGIC, 3, struct simtemp_levels)   //Replaces the threshold table of the device atomically
+#define SIMTEMP_IOC_GET_LEVELS      _IOR(SIMTEMP_IOC_MAGIC, 4, struct simtemp_levels)   //Reads the threshold table and the alert counters
+#define SIMTEMP_IOC_SET_LEVEL_MASK  _IOW(SIMTEMP_IOC_MAGIC, 5, __u32)                   //Levels this open file subscribes to (POLLPRI, alert-only filter)
+#define SIMTEMP_IOC_GET_LEVEL_MASK  _IOR(SIMTEMP_IOC_MAGIC, 6, __u32)                   //Reads back the level subscription of this open file
+#define SIMTEMP_IOC_SET_DELIVERY    _IOW(SIMTEMP_IOC_MAGIC, 7, __u32)                   //SIMTEMP_DELIVERY_SHARED or SIMTEMP_DELIVERY_BROADCAST for this open file
+#define SIMTEMP_IOC_GET_DELIVERY    _IOR(SIMTEMP_IOC_MAGIC, 8, __u32)                   //Reads back the delivery mode of this open file
+#define SIMTEMP_IOC_GET_STATS       _IOR(SIMTEMP_IOC_MAGIC, 9, struct simtemp_stats)    //Statistics snapshot of the device (same as stats_bin)
+#define SIMTEMP_IOC_GET_HISTORY     _IOWR(SIMTEMP_IOC_MAGIC, 10, struct simtemp_history)//Copies the last N samples or the samples since a timestamp (non-destructive)
+
+
+#endif // End of _NXP_SIMTEMP_IOCTL_H_
@@ -0,0 +1,802 @@
+/***************************************************************************
+	Open Source License 2025 NXP Semiconductor Challenge Stage
+****************************************************************************
+* Title        : nxp_simtemp_kunit.c
+* Description  : KUnit Suites and Microbenchmarks of the Ring Buffer, the Threshold Levels and the History Window
+*
+* Environment  : C Language (Kernel Space, KUnit)
+*
+* Responsible  : Daniel R Miranda [danielrmirandacortes@gmail.com]
+*
+* Guidelines   : Linux Kernel Coding Style
+*
+*
+* This file is not compiled alone: nxp_simtemp.c includes it at the end when the module is
+* built with 'make kunit' (SIMTEMP_KUNIT_TEST), so the suites call the static functions of the
+* driver directly. The suites run when the module is loaded in a kernel built with CONFIG_KUNIT
+* (UML or QEMU, see kernel/.kunitconfig and scripts/run_kunit.sh), no hardware is needed.
+*
+****************************************************************************
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* * * * * * * * * * * Header Files *   *   *   *   *   *   *   *   *   *   *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <kunit/test.h>             //KUnit: test cases, expectations and suites
+#include <linux/kthread.h>          //Producer thread of the concurrent push/pop stress test
+#include <linux/completion.h>       //End of the producer thread
+#include <linux/mman.h>             //PROT_*/MAP_*: user mapping of the history queries (kunit_vm_mmap)
+
+#if !IS_ENABLED(CONFIG_KUNIT)
+#error "SIMTEMP_KUNIT_TEST needs a kernel built with CONFIG_KUNIT=y"
+#endif
+
+
+//-------------------------- Parameters of the Microbenchmarks ------------------------------------
+static unsigned int bench_rounds = 20000;      //Rounds of RING_BUFFER_SIZE operations per benchmark
+module_param(bench_rounds, uint, 0444);
+MODULE_PARM_DESC(bench_rounds, "KUnit microbenchmarks: rounds of RING_BUFFER_SIZE operations (default 20000)");
+
+static unsigned int bench_max_ns;               //Regression limit in ns/op, 0: only report
+module_param(bench_max_ns, uint, 0444);
+MODULE_PARM_DESC(bench_max_ns, "KUnit microbenchmarks: fail when an operation costs more than this (ns/op, 0 = report only)");
+
+#define SIMTEMP_STRESS_SAMPLES  200000          //Samples pushed by the producer thread of the stress test
+#define SIMTEMP_TEST_BASE_mC    20000           //temp_mC of sample 'n' is SIMTEMP_TEST_BASE_mC + n
+
+
+// ---------------------- (Helpers)  ---------------------------------------
+
+//Device with only the fields used by the ring and the levels: no timer, no misc device, no sysfs.
+static struct nxp_simtemp_dev *simtemp_test_dev(struct kunit *test)
+{
+    struct nxp_simtemp_dev *dev = kunit_kzalloc(test, sizeof(*dev), GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, dev);
+
+    spin_lock_init(&dev->lock);
+    INIT_LIST_HEAD(&dev->files);
+    simtemp_buffer_init(&dev->rb);
+
+    return dev;
+}
+
+//Sample 'n' of a test sequence: every field is derived from n, so a pop can be checked field by field
+static struct simtemp_sample simtemp_test_sample(u32 n)
+{
+    struct simtemp_sample sample = {
+	.timestamp_ns = 1000000ULL * n,
+	.temp_mC = SIMTEMP_TEST_BASE_mC + n,
+	.flags = SAMPLE_AVAILABLE,
+    };
+
+    return sample;
+}
+
+static void simtemp_test_expect_sample(struct kunit *test, const struct simtemp_sample *sample, u32 n)
+{
+    KUNIT_EXPECT_EQ(test, sample->timestamp_ns, 1000000ULL * n);
+    KUNIT_EXPECT_EQ(test, sample->temp_mC, SIMTEMP_TEST_BASE_mC + (s32)n);
+    KUNIT_EXPECT_EQ(test, sample->flags, (u32)SAMPLE_AVAILABLE);
+}
+
+
+// ---------------------- (Suite: Ring Buffer)  ---------------------------------------
+
+//An empty ring reports empty and a pop leaves the caller's sample untouched
+static void simtemp_test_ring_empty(struct kunit *test)
+{
+    struct nxp_simtemp_dev *dev = simtemp_test_dev(test);
+    struct simtemp_sample out = { .temp_mC = -1 };
+
+    KUNIT_EXPECT_TRUE(test, simtemp_buffer_is_empty(dev));
+    KUNIT_EXPECT_FALSE(test, simtemp_buffer_pop(dev, &out));
+    KUNIT_EXPECT_EQ(test, out.temp_mC, -1);
+    KUNIT_EXPECT_EQ(test, dev->rb.seq, 0ULL);
+}
+
+//pop() copies the whole sample out to its caller and consumes it
+static void simtemp_test_ring_pop_copies(struct kunit *test)
+{
+    struct nxp_simtemp_dev *dev = simtemp_test_dev(test);
+    struct simtemp_sample in = simtemp_test_sample(7);
+    struct simtemp_sample out;
+
+    in.flags |= TRESHOLD_CROSSED | SIMTEMP_LEVEL_FLAG(1);
+    simtemp_buffer_push(dev, &in);
+    KUNIT_EXPECT_FALSE(test, simtemp_buffer_is_empty(dev));
+
+    memset(&out, 0xff, sizeof(out));
+    KUNIT_ASSERT_TRUE(test, simtemp_buffer_pop(dev, &out));
+    KUNIT_EXPECT_EQ(test, out.timestamp_ns, in.timestamp_ns);
+    KUNIT_EXPECT_EQ(test, out.temp_mC, in.temp_mC);
+    KUNIT_EXPECT_EQ(test, out.flags, in.flags);
+
+    KUNIT_EXPECT_TRUE(test, simtemp_buffer_is_empty(dev));
+    KUNIT_EXPECT_EQ(test, dev->rb.seq, 1ULL);
+}
+
+//Head and tail cross the end of the array several times while the queue stays almost full: FIFO order is kept
+static void simtemp_test_ring_wrap_around(struct kunit *test)
+{
+    struct nxp_simtemp_dev *dev = simtemp_test_dev(test);
+    struct simtemp_sample in, out;
+    u32 pushed = 0;
+    u32 popped = 0;
+    u32 i;
+
+    for (i = 0; i < RING_BUFFER_SIZE - 1; i++)
+    {
+	in = simtemp_test_sample(pushed++);
+	simtemp_buffer_push(dev, &in);
+    }
+
+    for (i = 0; i < 3 * RING_BUFFER_SIZE; i++)
+    {
+	in = simtemp_test_sample(pushed++);
+	simtemp_buffer_push(dev, &in);
+	KUNIT_EXPECT_EQ(test, dev->rb.count, (u32)RING_BUFFER_SIZE);
+
+	KUNIT_ASSERT_TRUE(test, simtemp_buffer_pop(dev, &out));
+	simtemp_test_expect_sample(test, &out, popped++);
+	KUNIT_EXPECT_LT(test, dev->rb.head, (size_t)RING_BUFFER_SIZE);
+	KUNIT_EXPECT_LT(test, dev->rb.tail, (size_t)RING_BUFFER_SIZE);
+    }
+
+    while (simtemp_buffer_pop(dev, &out))
+    {
+	simtemp_test_expect_sample(test, &out, popped++);
+    }
+
+    KUNIT_EXPECT_EQ(test, popped, pushed);
+    KUNIT_EXPECT_EQ(test, dev->rb.seq, (u64)pushed);
+    KUNIT_EXPECT_EQ(test, dev->rb.head, dev->rb.tail);
+}
+
+//A full ring overwrites the oldest samples: the newest RING_BUFFER_SIZE samples are kept in order
+static void simtemp_test_ring_overflow(struct kunit *test)
+{
+    struct nxp_simtemp_dev *dev = simtemp_test_dev(test);
+    struct simtemp_sample in, out;
+    const u32 extra = 5;
+    u32 n = extra;
+    u32 i;
+
+    for (i = 0; i < RING_BUFFER_SIZE + extra; i++)
+    {
+	in = simtemp_test_sample(i);
+	simtemp_buffer_push(dev, &in);
+    }
+
+    KUNIT_EXPECT_EQ(test, dev->rb.count, (u32)RING_BUFFER_SIZE);
+    KUNIT_EXPECT_EQ(test, dev->rb.seq, (u64)(RING_BUFFER_SIZE + extra));
+    KUNIT_EXPECT_EQ(test, dev->rb.head, (size_t)extra);
+    KUNIT_EXPECT_EQ(test, dev->rb.tail, (size_t)extra);
+
+    while (simtemp_buffer_pop(dev, &out))
+    {
+	simtemp_test_expect_sample(test, &out, n++);
+    }
+    KUNIT_EXPECT_EQ(test, n, (u32)(RING_BUFFER_SIZE + extra));
+}
+
+//A cursor (filtered or broadcast file) lapped by the producer restarts at the oldest sample and counts the loss
+static void simtemp_test_ring_cursor_overflow(struct kunit *test)
+{
+    struct nxp_simtemp_dev *dev = simtemp_test_dev(test);
+    struct simtemp_file *ctx = kunit_kzalloc(test, sizeof(*ctx), GFP_KERNEL);
+    struct simtemp_sample in;
+    const u32 extra = 8;
+    u32 i;
+
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, ctx);
+    ctx->dev = dev;
+    ctx->level_mask = SIMTEMP_LEVELS_ALL;   //No filter installed (mode 0): every sample is accepted
+
+    for (i = 0; i < RING_BUFFER_SIZE + extra; i++)
+    {
+	in = simtemp_test_sample(i);
+	simtemp_buffer_push(dev, &in);
+    }
+
+    KUNIT_ASSERT_TRUE(test, simtemp_filter_advance(dev, ctx));
+    KUNIT_EXPECT_EQ(test, ctx->dropped, (u64)extra);
+    KUNIT_EXPECT_EQ(test, ctx->cursor, (u64)extra);
+    simtemp_test_expect_sample(test, &dev->rb.buffer[ctx->cursor % RING_BUFFER_SIZE], extra);
+}
+
+
+//Concurrent stress: a kthread pushes like the hrtimer while the test pops like read(), both under dev->lock
+struct simtemp_stress
+{
+    struct nxp_simtemp_dev      *dev;
+    u32                         samples;
+    struct completion           done;
+};
+
+static int simtemp_stress_producer(void *data)
+{
+    struct simtemp_stress *st = data;
+    struct simtemp_sample sample;
+    unsigned long flags;
+    u32 i;
+
+    for (i = 0; i < st->samples; i++)
+    {
+	sample = simtemp_test_sample(i);
+
+	spin_lock_irqsave(&st->dev->lock, flags);
+	simtemp_buffer_push(st->dev, &sample);
+	spin_unlock_irqrestore(&st->dev->lock, flags);
+
+	if ((i % 64) == 0)
+	{
+	    cond_resched();     //Lets the consumer run on a single CPU (UML), overflows still happen
+	}
+    }
+
+    complete(&st->done);
+    return 0;
+}
+
+static void simtemp_test_ring_concurrent(struct kunit *test)
+{
+    struct nxp_simtemp_dev *dev = simtemp_test_dev(test);
+    struct simtemp_stress st = { .dev = dev, .samples = SIMTEMP_STRESS_SAMPLES };
+    struct task_struct *task;
+    struct simtemp_sample out;
+    unsigned long flags;
+    s64 last = -1;
+    u64 popped = 0;
+    u64 lost = 0;
+
+    init_completion(&st.done);
+    task = kthread_run(simtemp_stress_producer, &st, "simtemp_stress");
+    KUNIT_ASSERT_FALSE(test, IS_ERR(task));
+
+    for (;;)
+    {
+	bool finished = completion_done(&st.done);     //Read before the pop: an empty ring after the end means all was consumed
+	bool got;
+	u32 count;
+	s64 n;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	got = simtemp_buffer_pop(dev, &out);
+	count = dev->rb.count;
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	KUNIT_EXPECT_LT(test, count, (u32)RING_BUFFER_SIZE);
+
+	if (!got)
+	{
+	    if (finished)
+	    {
+		break;
+	    }
+	    cond_resched();
+	    continue;
+	}
+
+	//Samples come out in order: a gap is a sample overwritten by the producer, never a duplicate or a reorder
+	n = (s64)out.temp_mC - SIMTEMP_TEST_BASE_mC;
+	if (n <= last)
+	{
+	    KUNIT_FAIL(test, "sample %lld popped after sample %lld", n, last);
+	    wait_for_completion(&st.done);
+	    return;
+	}
+	simtemp_test_expect_sample(test, &out, (u32)n);
+
+	lost += n - last - 1;
+	last = n;
+	popped++;
+    }
+
+    KUNIT_EXPECT_EQ(test, last, (s64)st.samples - 1);
+    KUNIT_EXPECT_EQ(test, popped + lost, (u64)st.samples);
+    KUNIT_EXPECT_EQ(test, dev->rb.seq, (u64)st.samples);
+    KUNIT_EXPECT_TRUE(test, simtemp_buffer_is_empty(dev));
+    kunit_info(test, "%u samples: %llu popped, %llu overwritten\n", st.samples, popped, lost);
+}
+
+
+// ---------------------- (Suite: Threshold Levels and Alerts)  ---------------------------------------
+
+//Two levels: warning 45 C (hysteresis 1 C) and critical 55 C (hysteresis 0.5 C)
+static struct simtemp_config *simtemp_test_config(struct kunit *test)
+{
+    struct simtemp_config *cfg = kunit_kzalloc(test, sizeof(*cfg), GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, cfg);
+
+    cfg->nr_levels = 2;
+    cfg->levels_gen = 1;
+    cfg->levels[0].threshold_mC = 45000;
+    cfg->levels[0].hysteresis_mC = 1000;
+    cfg->levels[1].threshold_mC = 55000;
+    cfg->levels[1].hysteresis_mC = 500;
+
+    return cfg;
+}
+
+//A level is exceeded above its threshold and released only at threshold - hysteresis
+static const struct
+{
+    s32 temp_mC;
+    u32 mask;
+} simtemp_test_levels_seq[] = {
+    { 40000, 0 },
+    { 45000, 0 },                   //Equal to the threshold: not exceeded
+    { 45001, BIT(0) },
+    { 44500, BIT(0) },              //Inside the hysteresis band: still exceeded
+    { 55001, BIT(0) | BIT(1) },
+    { 54600, BIT(0) | BIT(1) },
+    { 54500, BIT(0) },              //Critical released at 55000 - 500
+    { 44000, 0 },                   //Warning released at 45000 - 1000
+};
+
+static void simtemp_test_levels_hysteresis(struct kunit *test)
+{
+    struct nxp_simtemp_dev *dev = simtemp_test_dev(test);
+    struct simtemp_config *cfg = simtemp_test_config(test);
+    u32 i;
+
+    for (i = 0; i < ARRAY_SIZE(simtemp_test_levels_seq); i++)
+    {
+	KUNIT_EXPECT_EQ_MSG(test, simtemp_levels_update(dev, cfg, simtemp_test_levels_seq[i].temp_mC),
+			    simtemp_test_levels_seq[i].mask, "sample %u (%d mC)", i, simtemp_test_levels_seq[i].temp_mC);
+    }
+
+    KUNIT_EXPECT_EQ(test, dev->levels_gen, cfg->levels_gen);
+    KUNIT_EXPECT_FALSE(test, dev->levels[0].active);
+    KUNIT_EXPECT_FALSE(test, dev->levels[1].active);
+}
+
+//Every exceeding sample counts one alert per level, and consuming the sample (read()) acknowledges it
+static void simtemp_test_levels_alert_accounting(struct kunit *test)
+{
+    struct nxp_simtemp_dev *dev = simtemp_test_dev(test);
+    struct simtemp_config *cfg = simtemp_test_config(test);
+    u32 masks[ARRAY_SIZE(simtemp_test_levels_seq)];
+    u32 i;
+
+    for (i = 0; i < ARRAY_SIZE(simtemp_test_levels_seq); i++)
+    {
+	masks[i] = simtemp_levels_update(dev, cfg, simtemp_test_levels_seq[i].temp_mC);
+    }
+
+    KUNIT_EXPECT_EQ(test, dev->levels[0].alerts, 5U);
+    KUNIT_EXPECT_EQ(test, dev->levels[1].alerts, 2U);
+    KUNIT_EXPECT_EQ(test, simtemp_levels_pending(dev), (u32)(BIT(0) | BIT(1)));
+
+    for (i = 0; i < ARRAY_SIZE(masks); i++)
+    {
+	simtemp_levels_ack(dev, SAMPLE_AVAILABLE | (masks[i] ? TRESHOLD_CROSSED : 0) | (masks[i] << SIMTEMP_LEVEL_SHIFT));
+    }
+
+    KUNIT_EXPECT_EQ(test, dev->levels[0].alerts, 0U);
+    KUNIT_EXPECT_EQ(test, dev->levels[1].alerts, 0U);
+    KUNIT_EXPECT_EQ(test, simtemp_levels_pending(dev), 0U);
+
+    //An acknowledgement without pending alerts does not underflow the counter
+    simtemp_levels_ack(dev, TRESHOLD_CROSSED | SIMTEMP_LEVEL_FLAG(0));
+    KUNIT_EXPECT_EQ(test, dev->levels[0].alerts, 0U);
+}
+
+//A new table restarts the hysteresis state, keeps the alerts of the levels still in use and clears the others
+static void simtemp_test_levels_new_table(struct kunit *test)
+{
+    struct nxp_simtemp_dev *dev = simtemp_test_dev(test);
+    struct simtemp_config *cfg = simtemp_test_config(test);
+
+    KUNIT_EXPECT_EQ(test, simtemp_levels_update(dev, cfg, 60000), (u32)(BIT(0) | BIT(1)));
+
+    cfg->nr_levels = 1;
+    cfg->levels_gen++;
+    KUNIT_EXPECT_EQ(test, simtemp_levels_update(dev, cfg, 44500), 0U);     //Inside the old band, but the state restarted
+
+    KUNIT_EXPECT_EQ(test, dev->levels[0].alerts, 1U);
+    KUNIT_EXPECT_EQ(test, dev->levels[1].alerts, 0U);
+    KUNIT_EXPECT_FALSE(test, dev->levels[1].active);
+    KUNIT_EXPECT_EQ(test, simtemp_levels_pending(dev), (u32)BIT(0));
+}
+
+
+// ---------------------- (Suite: Microbenchmarks)  ---------------------------------------
+//Each round runs RING_BUFFER_SIZE operations between two clock reads, with dev->lock held as in the driver.
+//Results are reported as ns/op in the KUnit log (dmesg or debugfs) to compare ring optimisations.
+
+static void simtemp_bench_report(struct kunit *test, const char *op, u64 ns, u64 ops)
+{
+    u64 centi_ns = div64_u64(ns * 100, ops ? ops : 1);
+    u32 rem;
+    u64 whole = div_u64_rem(centi_ns, 100, &rem);
+
+    kunit_info(test, "%s: %llu.%02u ns/op (%llu ops)\n", op, whole, rem, ops);
+
+    if (bench_max_ns)
+    {
+	KUNIT_EXPECT_LE_MSG(test, centi_ns, (u64)bench_max_ns * 100, "%s is slower than bench_max_ns=%u", op, bench_max_ns);
+    }
+}
+
+static void simtemp_bench_fill(struct nxp_simtemp_dev *dev, const struct simtemp_sample *sample, u32 n)
+{
+    u32 i;
+
+    for (i = 0; i < n; i++)
+    {
+	simtemp_buffer_push(dev, sample);
+    }
+}
+
+//push() into a ring with free space (consumer keeping up)
+static void simtemp_bench_push(struct kunit *test)
+{
+    struct nxp_simtemp_dev *dev = simtemp_test_dev(test);
+    struct simtemp_sample sample = simtemp_test_sample(1);
+    unsigned long flags;
+    u64 ns = 0;
+    u64 t0;
+    u32 r;
+
+    for (r = 0; r < bench_rounds; r++)
+    {
+	simtemp_buffer_init(&dev->rb);
+
+	spin_lock_irqsave(&dev->lock, flags);
+	t0 = ktime_get_ns();
+	simtemp_bench_fill(dev, &sample, RING_BUFFER_SIZE);
+	ns += ktime_get_ns() - t0;
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	cond_resched();
+    }
+
+    simtemp_bench_report(test, "push", ns, (u64)bench_rounds * RING_BUFFER_SIZE);
+}
+
+//push() into a full ring (no reader): every push overwrites the oldest sample
+static void simtemp_bench_push_overwrite(struct kunit *test)
+{
+    struct nxp_simtemp_dev *dev = simtemp_test_dev(test);
+    struct simtemp_sample sample = simtemp_test_sample(1);
+    unsigned long flags;
+    u64 ns = 0;
+    u64 t0;
+    u32 r;
+
+    simtemp_bench_fill(dev, &sample, RING_BUFFER_SIZE);
+
+    for (r = 0; r < bench_rounds; r++)
+    {
+	spin_lock_irqsave(&dev->lock, flags);
+	t0 = ktime_get_ns();
+	simtemp_bench_fill(dev, &sample, RING_BUFFER_SIZE);
+	ns += ktime_get_ns() - t0;
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	cond_resched();
+    }
+
+    simtemp_bench_report(test, "push (overwrite)", ns, (u64)bench_rounds * RING_BUFFER_SIZE);
+}
+
+//pop() of one sample at a time from a full ring
+static void simtemp_bench_pop(struct kunit *test)
+{
+    struct nxp_simtemp_dev *dev = simtemp_test_dev(test);
+    struct simtemp_sample sample = simtemp_test_sample(1);
+    struct simtemp_sample out;
+    unsigned long flags;
+    u64 ns = 0;
+    u64 ops = 0;
+    u64 t0;
+    u32 r;
+
+    for (r = 0; r < bench_rounds; r++)
+    {
+	simtemp_bench_fill(dev, &sample, RING_BUFFER_SIZE);
+
+	spin_lock_irqsave(&dev->lock, flags);
+	t0 = ktime_get_ns();
+	while (simtemp_buffer_pop(dev, &out))
+	{
+	    ops++;
+	}
+	ns += ktime_get_ns() - t0;
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	cond_resched();
+    }
+
+    KUNIT_EXPECT_EQ(test, ops, (u64)bench_rounds * RING_BUFFER_SIZE);
+    simtemp_bench_report(test, "pop", ns, ops);
+}
+
+//Bulk drain as read() does it: SIMTEMP_READ_BATCH samples per critical section into a stack batch
+static void simtemp_bench_bulk_drain(struct kunit *test)
+{
+    struct nxp_simtemp_dev *dev = simtemp_test_dev(test);
+    struct simtemp_sample sample = simtemp_test_sample(1);
+    struct simtemp_sample batch[SIMTEMP_READ_BATCH];
+    unsigned long flags;
+    u64 ns = 0;
+    u64 ops = 0;
+    u64 t0;
+    u32 r;
+    u32 n;
+
+    for (r = 0; r < bench_rounds; r++)
+    {
+	simtemp_bench_fill(dev, &sample, RING_BUFFER_SIZE);
+
+	t0 = ktime_get_ns();
+	do
+	{
+	    n = 0;
+	    spin_lock_irqsave(&dev->lock, flags);
+	    while (n < SIMTEMP_READ_BATCH && simtemp_buffer_pop(dev, &batch[n]))
+	    {
+		n++;
+	    }
+	    spin_unlock_irqrestore(&dev->lock, flags);
+	    ops += n;
+	} while (n == SIMTEMP_READ_BATCH);
+	ns += ktime_get_ns() - t0;
+
+	cond_resched();
+    }
+
+    KUNIT_EXPECT_EQ(test, ops, (u64)bench_rounds * RING_BUFFER_SIZE);
+    simtemp_bench_report(test, "bulk drain", ns, ops);
+}
+
+
+// ---------------------- (Suite: History Window)  ---------------------------------------
+
+//Pushes samples [from, to) of the test sequence into the history window
+static void simtemp_test_history_fill(struct nxp_simtemp_dev *dev, u32 from, u32 to)
+{
+    struct simtemp_sample sample;
+    u32 n;
+
+    for (n = from; n < to; n++)
+    {
+	sample = simtemp_test_sample(n);
+	simtemp_history_push(dev, &sample);
+    }
+}
+
+//Runs SIMTEMP_IOC_GET_HISTORY as a process would: the request and the samples live in a user mapping of the test.
+//Returns the number of samples copied to 'out' ('q' gets the reply: available, lost and next_seq).
+static u32 simtemp_test_history_query(struct kunit *test, struct nxp_simtemp_dev *dev, u32 mode, u32 count, u64 since_seq,
+				      struct simtemp_sample *out, struct simtemp_history *q)
+{
+    struct simtemp_history __user *uq;
+    unsigned long uaddr;
+
+    uaddr = kunit_vm_mmap(test, NULL, 0, sizeof(*q) + count * sizeof(*out), PROT_READ | PROT_WRITE,
+			  MAP_ANONYMOUS | MAP_PRIVATE, 0);
+    KUNIT_ASSERT_NE(test, uaddr, 0UL);
+    uq = (struct simtemp_history __user *)uaddr;
+
+    *q = (struct simtemp_history){ .mode = mode, .count = count, .since_seq = since_seq, .samples = uaddr + sizeof(*q) };
+    KUNIT_ASSERT_EQ(test, copy_to_user(uq, q, sizeof(*q)), 0UL);
+    KUNIT_ASSERT_EQ(test, simtemp_history_query(dev, uq), 0L);
+    KUNIT_ASSERT_EQ(test, copy_from_user(q, uq, sizeof(*q)), 0UL);
+    KUNIT_ASSERT_EQ(test, copy_from_user(out, u64_to_user_ptr(q->samples), q->count * sizeof(*out)), 0UL);
+
+    return q->count;
+}
+
+//The window keeps the newest 'len' samples in their sequence slots and the lengths are rounded up to a power of two
+static void simtemp_test_history_window(struct kunit *test)
+{
+    struct nxp_simtemp_dev *dev = simtemp_test_dev(test);
+    u64 n;
+
+    KUNIT_ASSERT_EQ(test, simtemp_history_resize(dev, 6), 0);
+    KUNIT_EXPECT_EQ(test, dev->hist.len, 8U);
+
+    simtemp_test_history_fill(dev, 0, 20);
+    KUNIT_EXPECT_EQ(test, dev->hist.seq, 20ULL);
+    for (n = 12; n < 20; n++)
+    {
+	simtemp_test_expect_sample(test, &dev->hist.buf[n & 7], n);
+    }
+
+    simtemp_history_free(dev);
+}
+
+//SIMTEMP_HISTORY_SINCE is keyed on the sequence: a clock step backwards does not reorder nor skip samples
+static void simtemp_test_history_since(struct kunit *test)
+{
+    struct nxp_simtemp_dev *dev = simtemp_test_dev(test);
+    struct simtemp_sample out[8], sample;
+    struct simtemp_history q;
+    u64 n;
+
+    KUNIT_ASSERT_EQ(test, simtemp_history_resize(dev, 8), 0);
+    simtemp_test_history_fill(dev, 0, 14);
+
+    //CLOCK_REALTIME stepped back: samples 14..19 are stamped before sample 13
+    for (n = 14; n < 20; n++)
+    {
+	sample = simtemp_test_sample(n);
+	sample.timestamp_ns -= 10000000ULL;
+	simtemp_history_push(dev, &sample);
+    }
+
+    //Continue from 15: 15..19, then the resume point is the end of the window
+    KUNIT_EXPECT_EQ(test, simtemp_test_history_query(test, dev, SIMTEMP_HISTORY_SINCE, 8, 15, out, &q), 5U);
+    KUNIT_EXPECT_EQ(test, q.lost, 0U);
+    KUNIT_EXPECT_EQ(test, q.next_seq, 20ULL);
+    for (n = 0; n < q.count; n++)
+    {
+	KUNIT_EXPECT_EQ(test, out[n].temp_mC, simtemp_test_sample(15 + n).temp_mC);
+    }
+
+    //Older than the window: the gap is lost, copying starts at the oldest one (12)
+    KUNIT_EXPECT_EQ(test, simtemp_test_history_query(test, dev, SIMTEMP_HISTORY_SINCE, 3, 9, out, &q), 3U);
+    KUNIT_EXPECT_EQ(test, q.lost, 3U);
+    KUNIT_EXPECT_EQ(test, q.next_seq, 15ULL);
+    simtemp_test_expect_sample(test, &out[0], 12);
+
+    //Up to date (or ahead of the producer): nothing, next_seq stays at the end
+    KUNIT_EXPECT_EQ(test, simtemp_test_history_query(test, dev, SIMTEMP_HISTORY_SINCE, 8, 20, out, &q), 0U);
+    KUNIT_EXPECT_EQ(test, q.next_seq, 20ULL);
+    KUNIT_EXPECT_EQ(test, simtemp_test_history_query(test, dev, SIMTEMP_HISTORY_SINCE, 8, 99, out, &q), 0U);
+    KUNIT_EXPECT_EQ(test, q.next_seq, 20ULL);
+
+    simtemp_history_free(dev);
+}
+
+//A resize keeps the newest samples that fit, a disabled window still advances its sequence
+static void simtemp_test_history_resize(struct kunit *test)
+{
+    struct nxp_simtemp_dev *dev = simtemp_test_dev(test);
+    u64 n;
+
+    KUNIT_ASSERT_EQ(test, simtemp_history_resize(dev, 8), 0);
+    simtemp_test_history_fill(dev, 0, 20);
+
+    //Shrink: samples 16..19 are kept
+    KUNIT_ASSERT_EQ(test, simtemp_history_resize(dev, 4), 0);
+    for (n = 16; n < 20; n++)
+    {
+	simtemp_test_expect_sample(test, &dev->hist.buf[n & 3], n);
+    }
+
+    //Grow: the same 4 samples, the next ones are appended after them
+    KUNIT_ASSERT_EQ(test, simtemp_history_resize(dev, 16), 0);
+    simtemp_test_history_fill(dev, 20, 24);
+    for (n = 16; n < 24; n++)
+    {
+	simtemp_test_expect_sample(test, &dev->hist.buf[n & 15], n);
+    }
+
+    //Disabled: no buffer, the sequence keeps counting and nothing is valid
+    KUNIT_ASSERT_EQ(test, simtemp_history_resize(dev, 0), 0);
+    KUNIT_EXPECT_NULL(test, dev->hist.buf);
+    simtemp_test_history_fill(dev, 24, 30);
+    KUNIT_EXPECT_EQ(test, dev->hist.seq, 30ULL);
+    KUNIT_EXPECT_EQ(test, simtemp_history_oldest(dev), 30ULL);
+
+    simtemp_history_free(dev);
+}
+
+//The slots of a grown (or re-enabled) window that no sample has written yet are never returned by the queries
+static void simtemp_test_history_grow(struct kunit *test)
+{
+    struct nxp_simtemp_dev *dev = simtemp_test_dev(test);
+    struct simtemp_sample out[16];
+    struct simtemp_history q;
+    u32 i;
+
+    KUNIT_ASSERT_EQ(test, simtemp_history_resize(dev, 4), 0);
+    simtemp_test_history_fill(dev, 0, 20);
+
+    //Grow 4 -> 16 at seq 20: only samples 16..19 are valid
+    KUNIT_ASSERT_EQ(test, simtemp_history_resize(dev, 16), 0);
+    KUNIT_EXPECT_EQ(test, simtemp_history_oldest(dev), 16ULL);
+
+    KUNIT_EXPECT_EQ(test, simtemp_test_history_query(test, dev, SIMTEMP_HISTORY_LAST, 16, 0, out, &q), 4U);
+    KUNIT_EXPECT_EQ(test, q.available, 4U);
+    KUNIT_EXPECT_EQ(test, q.lost, 0U);
+    for (i = 0; i < q.count; i++)
+    {
+	simtemp_test_expect_sample(test, &out[i], 16 + i);
+    }
+
+    KUNIT_EXPECT_EQ(test, simtemp_test_history_query(test, dev, SIMTEMP_HISTORY_SINCE, 16, 0, out, &q), 4U);
+    simtemp_test_expect_sample(test, &out[0], 16);
+
+    //The window fills up from there: 12 samples later it is complete
+    simtemp_test_history_fill(dev, 20, 32);
+    KUNIT_EXPECT_EQ(test, simtemp_test_history_query(test, dev, SIMTEMP_HISTORY_LAST, 16, 0, out, &q), 16U);
+    KUNIT_EXPECT_EQ(test, q.available, 16U);
+    for (i = 0; i < q.count; i++)
+    {
+	simtemp_test_expect_sample(test, &out[i], 16 + i);
+    }
+
+    //Re-enabled after history_len=0: empty until the producer writes again
+    KUNIT_ASSERT_EQ(test, simtemp_history_resize(dev, 0), 0);
+    simtemp_test_history_fill(dev, 32, 40);
+    KUNIT_ASSERT_EQ(test, simtemp_history_resize(dev, 8), 0);
+    KUNIT_EXPECT_EQ(test, simtemp_test_history_query(test, dev, SIMTEMP_HISTORY_LAST, 8, 0, out, &q), 0U);
+    KUNIT_EXPECT_EQ(test, q.available, 0U);
+
+    simtemp_test_history_fill(dev, 40, 43);
+    KUNIT_EXPECT_EQ(test, simtemp_test_history_query(test, dev, SIMTEMP_HISTORY_SINCE, 8, 0, out, &q), 3U);
+    KUNIT_EXPECT_EQ(test, q.available, 3U);
+    for (i = 0; i < q.count; i++)
+    {
+	simtemp_test_expect_sample(test, &out[i], 40 + i);
+    }
+
+    //Shrink 8 -> 4 with only 3 valid samples: nothing older than them is carried over
+    KUNIT_ASSERT_EQ(test, simtemp_history_resize(dev, 4), 0);
+    KUNIT_EXPECT_EQ(test, simtemp_test_history_query(test, dev, SIMTEMP_HISTORY_LAST, 8, 0, out, &q), 3U);
+    simtemp_test_expect_sample(test, &out[0], 40);
+
+    simtemp_history_free(dev);
+}
+
+
+// ---------------------- (Suites Registration)  ---------------------------------------
+static struct kunit_case simtemp_ring_cases[] = {
+    KUNIT_CASE(simtemp_test_ring_empty),
+    KUNIT_CASE(simtemp_test_ring_pop_copies),
+    KUNIT_CASE(simtemp_test_ring_wrap_around),
+    KUNIT_CASE(simtemp_test_ring_overflow),
+    KUNIT_CASE(simtemp_test_ring_cursor_overflow),
+    KUNIT_CASE(simtemp_test_ring_concurrent),
+    {}
+};
+
+static struct kunit_suite simtemp_ring_suite = {
+    .name = "nxp_simtemp_ring",
+    .test_cases = simtemp_ring_cases,
+};
+
+static struct kunit_case simtemp_levels_cases[] = {
+    KUNIT_CASE(simtemp_test_levels_hysteresis),
+    KUNIT_CASE(simtemp_test_levels_alert_accounting),
+    KUNIT_CASE(simtemp_test_levels_new_table),
+    {}
+};
+
+static struct kunit_suite simtemp_levels_suite = {
+    .name = "nxp_simtemp_levels",
+    .test_cases = simtemp_levels_cases,
+};
+
+static struct kunit_case simtemp_history_cases[] = {
+    KUNIT_CASE(simtemp_test_history_window),
+    KUNIT_CASE(simtemp_test_history_since),
+    KUNIT_CASE(simtemp_test_history_resize),
+    KUNIT_CASE(simtemp_test_history_grow),
+    {}
+};
+
+static struct kunit_suite simtemp_history_suite = {
+    .name = "nxp_simtemp_history",
+    .test_cases = simtemp_history_cases,
+};
+
+static struct kunit_case simtemp_bench_cases[] = {
+    KUNIT_CASE(simtemp_bench_push),
+    KUNIT_CASE(simtemp_bench_push_overwrite),
+    KUNIT_CASE(simtemp_bench_pop),
+    KUNIT_CASE(simtemp_bench_bulk_drain),
+    {}
+};
+
+static struct kunit_suite simtemp_bench_suite = {
+    .name = "nxp_simtemp_bench",
+    .test_cases = simtemp_bench_cases,
+};
+
+kunit_test_suites(&simtemp_ring_suite, &simtemp_levels_suite, &simtemp_history_suite, &simtemp_bench_suite);
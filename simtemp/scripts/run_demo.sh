@@ -50,6 +50,12 @@ if [ -d "$SYSFS_DEVICE_DIR" ]; then
     sudo chmod 666 "$DEVICE_FILE"
     #permits for clear_alert
     sudo chmod 666 "$SYSFS_DEVICE_DIR/clear_alert"
+    #permits for threshold table and producer override
+    sudo chmod 666 "$SYSFS_DEVICE_DIR/levels"
+    sudo chmod 666 "$SYSFS_DEVICE_DIR/always_on"
+    sudo chmod 666 "$SYSFS_DEVICE_DIR/timer_slack_ns"
+    sudo chmod 666 "$SYSFS_DEVICE_DIR/timer_mode"
+    sudo chmod 666 "$SYSFS_DEVICE_DIR/producer_cpus"
 
     sudo chmod 666 "$DEVICE_FILE"
 
@@ -0,0 +1,47 @@
+#!/bin/bash
+# scripts/run_kunit.sh: Builds nxp_simtemp.ko with the KUnit suites, loads it and prints the KTAP results.
+# Runs inside a kernel built with CONFIG_KUNIT=y (UML or QEMU guest configured with kernel/.kunitconfig).
+#
+# Usage: sudo ./run_kunit.sh [module parameters]
+#   e.g. sudo KERNEL_DIR=~/linux ARCH=um ./run_kunit.sh bench_rounds=50000 bench_max_ns=200
+# Exit code: 0 when every suite passed, 1 otherwise.
+
+MODULE_NAME="nxp_simtemp"
+KERNEL_SRC_PATH="$(dirname "$0")/../kernel"
+KUNIT_DEBUGFS="/sys/kernel/debug/kunit"
+SUITES="nxp_simtemp_ring nxp_simtemp_levels nxp_simtemp_history nxp_simtemp_bench"
+
+# Error Handling: Prints the message and returns 1
+fail()
+{
+    echo "--- ERROR: $1 ---" >&2
+    exit 1
+}
+
+echo "----- 1. Compiling ${MODULE_NAME}.ko with the KUnit suites -----"
+make -C "$KERNEL_SRC_PATH" kunit ${KERNEL_DIR:+KERNEL_DIR="$KERNEL_DIR"} ${ARCH:+ARCH="$ARCH"} || fail "Compilation Failed of Kernel Module"
+
+echo "----- 2. Loading the module (the suites run at load time) -----"
+lsmod | grep -q "^${MODULE_NAME} " && rmmod "$MODULE_NAME"
+insmod "$KERNEL_SRC_PATH/${MODULE_NAME}.ko" "$@" || fail "insmod failed (kernel without CONFIG_KUNIT?)"
+
+echo "----- 3. Results (KTAP) -----"
+RESULT=0
+for suite in $SUITES; do
+    if [ ! -r "$KUNIT_DEBUGFS/$suite/results" ]; then
+        echo "--- $suite: no results in $KUNIT_DEBUGFS (CONFIG_KUNIT_DEBUGFS, debugfs mounted?), see dmesg ---"
+        RESULT=1
+        continue
+    fi
+    cat "$KUNIT_DEBUGFS/$suite/results"
+    grep -q "not ok" "$KUNIT_DEBUGFS/$suite/results" && RESULT=1
+done
+
+rmmod "$MODULE_NAME"
+
+if [ $RESULT -eq 0 ]; then
+    echo "----- KUnit: SUCCESS -----"
+else
+    echo "----- KUnit: FAIL -----"
+fi
+exit $RESULT
@@ -0,0 +1,355 @@
+/***************************************************************************
+	Open Source License 2025 NXP Semiconductor Challenge Stage
+****************************************************************************
+* Title        : simtemp_bench.c
+* Description  : Wakeup benchmark of /dev/simtemp: context switches per delivered sample
+*                with 1..64 concurrent readers (shared, broadcast and poll() consumers)
+*
+* Environment  : C Language (User Space)
+*
+* Responsible  : Daniel R Miranda [danielrmirandacortes@gmail.com]
+*
+* Guidelines   : Linux Kernel Coding Style
+*
+*
+* Each reader is a process. Its voluntary + involuntary context switches (getrusage) are
+* accounted only while it consumes samples, and divided by the samples it received:
+*   shared    : blocking read(), SIMTEMP_DELIVERY_SHARED   (exclusive wakeups, each sample delivered once)
+*   broadcast : blocking read(), SIMTEMP_DELIVERY_BROADCAST (every reader receives every sample)
+*   poll      : poll() + O_NONBLOCK read() on the shared queue (every poller is woken: thundering herd)
+*
+****************************************************************************
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* * * * * * * * * * * Header Files *   *   *   *   *   *   *   *   *   *   *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "../../kernel/nxp_simtemp_ioctl.h"    //User/Kernel Contract: struct simtemp_sample and SIMTEMP_IOC_SET_DELIVERY
+
+#define BENCH_MAX_READERS   64
+
+enum bench_mode
+{
+    BENCH_SHARED = 0,
+    BENCH_BROADCAST,
+    BENCH_POLL,
+};
+
+static const char *const bench_mode_name[] = { "shared", "broadcast", "poll" };
+
+//Result of one reader, written by the child in a MAP_SHARED page
+struct bench_result
+{
+    unsigned long samples;      //Samples received
+    unsigned long spurious;     //Wakeups that found nothing to read (EAGAIN after poll())
+    long csw;                   //Voluntary + involuntary context switches while consuming
+    int error;                  //errno of a failed open()/ioctl()
+};
+
+static const char *device_path = "/dev/simtemp";
+static const char *sysfs_path = "/sys/devices/platform/nxp_simtemp";
+
+static volatile sig_atomic_t bench_stop;
+
+static void bench_alarm(int sig)
+{
+    (void)sig;
+    bench_stop = 1;
+}
+
+//Reads one counter of /sys/.../stats ("updates = N")
+static unsigned long bench_read_stat(const char *name)
+{
+    char path[256];
+    char line[128];
+    unsigned long value = 0;
+    size_t len = strlen(name);
+    FILE *f;
+
+    snprintf(path, sizeof(path), "%s/stats", sysfs_path);
+    f = fopen(path, "r");
+    if (!f)
+    {
+	return 0;
+    }
+
+    while (fgets(line, sizeof(line), f))
+    {
+	if (!strncmp(line, name, len) && line[len] == ' ')
+	{
+	    sscanf(line + len, " = %lu", &value);
+	    break;
+	}
+    }
+    fclose(f);
+
+    return value;
+}
+
+static int bench_write_sysfs(const char *attr, const char *value)
+{
+    char path[256];
+    FILE *f;
+
+    snprintf(path, sizeof(path), "%s/%s", sysfs_path, attr);
+    f = fopen(path, "w");
+    if (!f)
+    {
+	return -1;
+    }
+    fputs(value, f);
+
+    return fclose(f);
+}
+
+static long bench_csw(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+
+    return ru.ru_nvcsw + ru.ru_nivcsw;
+}
+
+//Child process: consumes samples until SIGALRM and reports its counters
+static void bench_reader(enum bench_mode mode, int start_fd, unsigned int seconds, struct bench_result *res)
+{
+    struct simtemp_sample sample[8];
+    struct sigaction sa;
+    struct pollfd pfd;
+    __u32 delivery = (mode == BENCH_BROADCAST) ? SIMTEMP_DELIVERY_BROADCAST : SIMTEMP_DELIVERY_SHARED;
+    char go;
+    ssize_t n;
+    long csw;
+    int fd;
+
+    //No SA_RESTART: the alarm interrupts a blocking read()/poll() with EINTR
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = bench_alarm;
+    sigaction(SIGALRM, &sa, NULL);
+
+    fd = open(device_path, O_RDONLY | (mode == BENCH_POLL ? O_NONBLOCK : 0));
+    if (fd < 0 || ioctl(fd, SIMTEMP_IOC_SET_DELIVERY, &delivery))
+    {
+	res->error = errno;
+	_exit(1);
+    }
+
+    //Start barrier: every reader is attached before the measurement starts
+    if (read(start_fd, &go, 1) != 1)
+    {
+	_exit(1);
+    }
+    alarm(seconds);
+    csw = bench_csw();
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+
+    while (!bench_stop)
+    {
+	if (mode == BENCH_POLL && poll(&pfd, 1, -1) < 0)
+	{
+	    continue;
+	}
+
+	n = read(fd, sample, sizeof(sample));
+	if (n > 0)
+	{
+	    res->samples += n / sizeof(sample[0]);
+	}
+	else if (n < 0 && errno == EAGAIN)
+	{
+	    res->spurious++;
+	}
+    }
+
+    res->csw = bench_csw() - csw;
+    close(fd);
+    _exit(0);
+}
+
+//One measurement: 'readers' processes in 'mode' during 'seconds'
+static int bench_run(enum bench_mode mode, int readers, unsigned int seconds, struct bench_result *res)
+{
+    unsigned long produced, samples = 0, spurious = 0;
+    pid_t pids[BENCH_MAX_READERS];
+    long csw = 0;
+    int start[2];
+    int i;
+
+    memset(res, 0, sizeof(*res) * readers);
+
+    if (pipe(start))
+    {
+	return -1;
+    }
+
+    for (i = 0; i < readers; i++)
+    {
+	pids[i] = fork();
+	if (pids[i] < 0)
+	{
+	    perror("fork");
+	    //The readers already forked are blocked on the barrier: released (EOF), killed and reaped
+	    close(start[0]);
+	    close(start[1]);
+	    while (i-- > 0)
+	    {
+		kill(pids[i], SIGKILL);
+		waitpid(pids[i], NULL, 0);
+	    }
+	    return -1;
+	}
+	if (pids[i] == 0)
+	{
+	    close(start[1]);
+	    bench_reader(mode, start[0], seconds, &res[i]);
+	}
+    }
+    close(start[0]);
+
+    //Readers open the device and block on the barrier; the producer is already running
+    usleep(200000);
+    produced = bench_read_stat("updates");
+    for (i = 0; i < readers; i++)
+    {
+	if (write(start[1], "g", 1) != 1)
+	{
+	    break;
+	}
+    }
+    close(start[1]);
+
+    while (wait(NULL) > 0)
+    {
+	;
+    }
+    produced = bench_read_stat("updates") - produced;
+
+    for (i = 0; i < readers; i++)
+    {
+	if (res[i].error)
+	{
+	    fprintf(stderr, "reader %d: %s\n", i, strerror(res[i].error));
+	    return -1;
+	}
+	samples += res[i].samples;
+	spurious += res[i].spurious;
+	csw += res[i].csw;
+    }
+
+    printf("%-10s %7d %9lu %10lu %10ld %10lu %12.2f\n", bench_mode_name[mode], readers,
+	   produced, samples, csw, spurious, samples ? (double)csw / samples : 0.0);
+    fflush(stdout);
+
+    return 0;
+}
+
+static void bench_usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-d device] [-s sysfs_dir] [-p sampling_ms] [-t seconds] [-n max_readers] [-m shared|broadcast|poll]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+    struct bench_result *res;
+    const char *sampling_ms = NULL;
+    unsigned int seconds = 5;
+    int max_readers = BENCH_MAX_READERS;
+    int only_mode = -1;
+    int mode, readers, opt;
+
+    while ((opt = getopt(argc, argv, "d:s:p:t:n:m:h")) != -1)
+    {
+	switch (opt)
+	{
+	case 'd':
+	    device_path = optarg;
+	    break;
+	case 's':
+	    sysfs_path = optarg;
+	    break;
+	case 'p':
+	    sampling_ms = optarg;
+	    break;
+	case 't':
+	    seconds = strtoul(optarg, NULL, 10);
+	    break;
+	case 'n':
+	    max_readers = atoi(optarg);
+	    break;
+	case 'm':
+	    for (mode = BENCH_SHARED; mode <= BENCH_POLL; mode++)
+	    {
+		if (!strcmp(optarg, bench_mode_name[mode]))
+		{
+		    only_mode = mode;
+		}
+	    }
+	    if (only_mode < 0)
+	    {
+		bench_usage(argv[0]);
+		return 2;
+	    }
+	    break;
+	default:
+	    bench_usage(argv[0]);
+	    return 2;
+	}
+    }
+
+    if (seconds == 0 || max_readers < 1 || max_readers > BENCH_MAX_READERS)
+    {
+	bench_usage(argv[0]);
+	return 2;
+    }
+
+    //A reader that failed to open the device closes its end of the start barrier
+    signal(SIGPIPE, SIG_IGN);
+
+    if (sampling_ms && bench_write_sysfs("sampling_ms", sampling_ms))
+    {
+	perror("sampling_ms");
+	return 1;
+    }
+
+    res = mmap(NULL, sizeof(*res) * BENCH_MAX_READERS, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (res == MAP_FAILED)
+    {
+	perror("mmap");
+	return 1;
+    }
+
+    printf("%-10s %7s %9s %10s %10s %10s %12s\n", "mode", "readers", "produced", "delivered", "csw", "spurious", "csw/sample");
+
+    for (mode = BENCH_SHARED; mode <= BENCH_POLL; mode++)
+    {
+	if (only_mode >= 0 && mode != only_mode)
+	{
+	    continue;
+	}
+
+	for (readers = 1; readers <= max_readers; readers *= 2)
+	{
+	    if (bench_run(mode, readers, seconds, res))
+	    {
+		return 1;
+	    }
+	}
+    }
+
+    return 0;
+}
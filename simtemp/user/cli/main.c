@@ -0,0 +1,368 @@
+/***************************************************************************
+	Open Source License 2025 NXP Semiconductor Challenge Stage
+****************************************************************************
+* Title        : main.c
+* Description  : Native alert latency probe of /dev/simtemp (same probe as 'main.py --probe')
+*
+* Environment  : C Language (User Space)
+*
+* Responsible  : Daniel R Miranda [danielrmirandacortes@gmail.com]
+*
+* Guidelines   : Linux Kernel Coding Style
+*
+*
+* Every event forces one threshold crossing through sysfs:
+*   disarm : threshold_mC = PROBE_HIGH_mC, clear_alert, the queue is drained
+*   arm    : threshold_mC = PROBE_LOW_mC, the next sample produced carries TRESHOLD_CROSSED
+*   wait   : poll(POLLPRI), then read() until the alert sample is found
+* and measures, against sample.timestamp_ns (CLOCK_REALTIME of the producer):
+*   POLLPRI : return of poll()
+*   read()  : return of the read() that delivered the alert sample
+*
+****************************************************************************
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* * * * * * * * * * * Header Files *   *   *   *   *   *   *   *   *   *   *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "../../kernel/nxp_simtemp_ioctl.h"    //User/Kernel Contract: struct simtemp_sample, TRESHOLD_CROSSED and SIMTEMP_IOC_SET_DELIVERY
+
+//Thresholds used to force a crossing: every sample exceeds PROBE_LOW_mC and none exceeds PROBE_HIGH_mC
+#define PROBE_LOW_mC	    "0"
+#define PROBE_HIGH_mC	    "1000000"
+
+#define PROBE_BATCH	    32	    //Samples per read(): the whole ring
+#define PROBE_NR_BUCKETS    11
+
+//Histogram upper bounds in microseconds (same buckets as main.py); the last bucket has no bound
+static const unsigned int probe_bucket_us[PROBE_NR_BUCKETS - 1] = { 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000 };
+
+static const char *device_path = "/dev/simtemp";
+static const char *sysfs_path = "/sys/devices/platform/nxp_simtemp";
+
+static volatile sig_atomic_t probe_stop;
+
+static void probe_sigint(int sig)
+{
+    (void)sig;
+    probe_stop = 1;
+}
+
+static unsigned long long probe_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);	    //Same clock as ktime_get_real_ns() of the producer
+
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int probe_write_sysfs(const char *attr, const char *value)
+{
+    char path[256];
+    FILE *f;
+
+    snprintf(path, sizeof(path), "%s/%s", sysfs_path, attr);
+    f = fopen(path, "w");
+    if (!f)
+    {
+	return -1;
+    }
+    fputs(value, f);
+
+    return fclose(f);
+}
+
+static int probe_read_sysfs(const char *attr, char *value, size_t size)
+{
+    char path[256];
+    FILE *f;
+
+    snprintf(path, sizeof(path), "%s/%s", sysfs_path, attr);
+    f = fopen(path, "r");
+    if (!f)
+    {
+	return -1;
+    }
+    if (!fgets(value, size, f))
+    {
+	value[0] = '\0';
+    }
+    fclose(f);
+    value[strcspn(value, "\n")] = '\0';
+
+    return 0;
+}
+
+static void probe_drain(int fd)
+{
+    struct simtemp_sample sample[PROBE_BATCH];
+
+    while (read(fd, sample, sizeof(sample)) > 0)
+    {
+	;
+    }
+}
+
+static int probe_cmp(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+//Nearest rank percentile of a sorted array
+static double probe_percentile(const double *v, unsigned int n, unsigned int p)
+{
+    unsigned int i = (unsigned int)((unsigned long long)p * n / 100);
+
+    return v[i < n ? i : n - 1];
+}
+
+static void probe_report(double *poll_us, double *read_us, unsigned int n)
+{
+    unsigned int count[PROBE_NR_BUCKETS] = { 0 };
+    unsigned int i, b, bar;
+    char label[16];
+
+    qsort(poll_us, n, sizeof(*poll_us), probe_cmp);
+    qsort(read_us, n, sizeof(*read_us), probe_cmp);
+
+    printf("%-14s %9s %9s %9s\n", "latency (us)", "p50", "p99", "max");
+    printf("%-14s %9.1f %9.1f %9.1f\n", "POLLPRI",
+	   probe_percentile(poll_us, n, 50), probe_percentile(poll_us, n, 99), poll_us[n - 1]);
+    printf("%-14s %9.1f %9.1f %9.1f\n", "read()",
+	   probe_percentile(read_us, n, 50), probe_percentile(read_us, n, 99), read_us[n - 1]);
+
+    printf("histogram of sample.timestamp_ns -> read() return:\n");
+    for (i = 0; i < n; i++)
+    {
+	for (b = 0; b < PROBE_NR_BUCKETS - 1 && read_us[i] >= probe_bucket_us[b]; b++)
+	{
+	    ;
+	}
+	count[b]++;
+    }
+
+    for (b = 0; b < PROBE_NR_BUCKETS; b++)
+    {
+	if (b < PROBE_NR_BUCKETS - 1)
+	{
+	    snprintf(label, sizeof(label), "< %uus", probe_bucket_us[b]);
+	}
+	else
+	{
+	    snprintf(label, sizeof(label), ">= %uus", probe_bucket_us[b - 1]);
+	}
+	printf("  %10s %7u ", label, count[b]);
+	for (bar = (count[b] * 50 + n - 1) / n; bar > 0; bar--)
+	{
+	    putchar('#');
+	}
+	putchar('\n');
+    }
+}
+
+static void probe_usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-d device] [-s sysfs_dir] [-n events] [-p sampling_ms] [-b] [-l p99_limit_us]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+    struct simtemp_sample sample[PROBE_BATCH];
+    char old_sampling[32], old_threshold[32], sampling[32];
+    const char *sampling_ms = NULL;
+    unsigned int events = 1000, done = 0, missed = 0, repeated = 0;
+    unsigned long long armed_ns, poll_ns, read_ns, alert_ns;
+    double *poll_us, *read_us, limit_us = 0;
+    struct sigaction sa;
+    struct pollfd pfd;
+    int broadcast = 0;
+    int timeout_ms;
+    int opt, fd, i;
+    ssize_t n;
+
+    while ((opt = getopt(argc, argv, "d:s:n:p:bl:h")) != -1)
+    {
+	switch (opt)
+	{
+	case 'd':
+	    device_path = optarg;
+	    break;
+	case 's':
+	    sysfs_path = optarg;
+	    break;
+	case 'n':
+	    events = strtoul(optarg, NULL, 10);
+	    break;
+	case 'p':
+	    sampling_ms = optarg;
+	    break;
+	case 'b':
+	    broadcast = 1;
+	    break;
+	case 'l':
+	    limit_us = strtod(optarg, NULL);
+	    break;
+	default:
+	    probe_usage(argv[0]);
+	    return 2;
+	}
+    }
+
+    if (events == 0)
+    {
+	probe_usage(argv[0]);
+	return 2;
+    }
+
+    poll_us = calloc(events, sizeof(*poll_us));
+    read_us = calloc(events, sizeof(*read_us));
+    if (!poll_us || !read_us)
+    {
+	perror("calloc");
+	return 1;
+    }
+
+    if (probe_read_sysfs("sampling_ms", old_sampling, sizeof(old_sampling)) ||
+	probe_read_sysfs("threshold_mC", old_threshold, sizeof(old_threshold)))
+    {
+	perror(sysfs_path);
+	return 1;
+    }
+    if (sampling_ms && probe_write_sysfs("sampling_ms", sampling_ms))
+    {
+	perror("sampling_ms");
+	return 1;
+    }
+    probe_read_sysfs("sampling_ms", sampling, sizeof(sampling));
+    //An event waits one sample at most: one period plus a margin for the scheduling of this process
+    timeout_ms = 2 * atoi(sampling) + 1000;
+
+    fd = open(device_path, O_RDONLY | O_NONBLOCK);
+    if (fd < 0)
+    {
+	perror(device_path);
+	return 1;
+    }
+    if (broadcast)
+    {
+	__u32 delivery = SIMTEMP_DELIVERY_BROADCAST;
+
+	if (ioctl(fd, SIMTEMP_IOC_SET_DELIVERY, &delivery))
+	{
+	    perror("SIMTEMP_IOC_SET_DELIVERY");
+	    return 1;
+	}
+    }
+
+    //Ctrl+C ends the probe with the events measured so far, the configuration is restored
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = probe_sigint;
+    sigaction(SIGINT, &sa, NULL);
+
+    pfd.fd = fd;
+    pfd.events = POLLPRI;
+
+    printf("--- ALERT LATENCY PROBE: %u threshold crossings (sampling_ms=%s, %s delivery, native consumer) ---\n",
+	   events, sampling, broadcast ? "broadcast" : "shared");
+
+    while (!probe_stop && done + missed < events)
+    {
+	//Disarm: no sample exceeds the threshold, pending alerts and queued samples are discarded
+	probe_write_sysfs("threshold_mC", PROBE_HIGH_mC);
+	probe_write_sysfs("clear_alert", "1");
+	probe_drain(fd);
+
+	//Arm: the next sample produced crosses the threshold. Older samples are not part of this event.
+	armed_ns = probe_now_ns();
+	probe_write_sysfs("threshold_mC", PROBE_LOW_mC);
+
+	alert_ns = 0;
+	poll_ns = read_ns = 0;
+	while (!alert_ns && !probe_stop)
+	{
+	    if (poll(&pfd, 1, timeout_ms) <= 0)
+	    {
+		break;
+	    }
+	    poll_ns = probe_now_ns();
+
+	    n = read(fd, sample, sizeof(sample));
+	    if (n <= 0)
+	    {
+		continue;
+	    }
+	    read_ns = probe_now_ns();
+
+	    for (i = 0; i < n / (ssize_t)sizeof(sample[0]); i++)
+	    {
+		if ((sample[i].flags & TRESHOLD_CROSSED) && sample[i].timestamp_ns >= armed_ns)
+		{
+		    alert_ns = sample[i].timestamp_ns;
+		    break;
+		}
+	    }
+	}
+
+	if (probe_stop)
+	{
+	    break;
+	}
+	if (!alert_ns)
+	{
+	    missed++;
+	    continue;
+	}
+
+	//The POLLPRI came from a sample produced before the arm and the alert sample arrived in the same read():
+	//the wakeup of this event was not observed, the event is repeated
+	if (poll_ns < alert_ns)
+	{
+	    repeated++;
+	    continue;
+	}
+
+	poll_us[done] = (poll_ns - alert_ns) / 1000.0;
+	read_us[done] = (read_ns - alert_ns) / 1000.0;
+	done++;
+    }
+
+    close(fd);
+    probe_write_sysfs("threshold_mC", old_threshold);
+    if (sampling_ms)
+    {
+	probe_write_sysfs("sampling_ms", old_sampling);
+    }
+    probe_write_sysfs("clear_alert", "1");
+
+    if (done == 0)
+    {
+	printf("--- FAIL: no threshold alert was delivered.\n");
+	return 1;
+    }
+
+    probe_report(poll_us, read_us, done);
+    printf("events=%u missed=%u repeated=%u\n", done, missed, repeated);
+
+    if (missed || (limit_us > 0 && probe_percentile(read_us, done, 99) > limit_us))
+    {
+	printf("--- FAIL: %u alerts missed, p99 limit %.0fus.\n", missed, limit_us);
+	return 1;
+    }
+
+    printf("--- SUCCESS: every forced crossing was delivered.\n");
+
+    return 0;
+}
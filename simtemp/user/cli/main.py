@@ -1,18 +1,23 @@
 import os
+import fcntl
 import select
 import struct
 import sys
 import time
+import threading
 import argparse
+import ctypes
 from datetime import datetime, timezone 
 
 # --- Contract Configuration ---
 
 # Data Access Point: Path to file of Character Device created by Driver
-DEVICE_PATH = "/dev/simtemp"
+# SIMTEMP_DEVICE overrides it, e.g. the data file of the User Space emulator (user/emu/simtemp_emu)
+DEVICE_PATH = os.environ.get("SIMTEMP_DEVICE", "/dev/simtemp")
 
 # Configuration access point: Directory where the Control Files are set.
-SYSFS_BASE_PATH = "/sys/devices/platform/nxp_simtemp" 
+# SIMTEMP_SYSFS overrides it, e.g. the sysfs/ directory of the emulator
+SYSFS_BASE_PATH = os.environ.get("SIMTEMP_SYSFS", "/sys/devices/platform/nxp_simtemp")
 
 #Size of Register simtemp_sample (bytes) for os.read()
 SAMPLE_SIZE = 16  
@@ -35,6 +40,39 @@ FLAG_THRESHOLD_CROSSED = 0x02
 #
 FLAG_NEW_SAMPLE = 0x01
 
+# Threshold levels exceeded by the sample: bits 8..11 of flags (bit 8 = level 0)
+LEVEL_SHIFT = 8
+LEVEL_MASK = 0x0F
+
+# --- ioctl Contract (kernel/nxp_simtemp_ioctl.h) ---
+
+# Per-file filter modes (SIMTEMP_FILTER_*)
+FILTER_ALERT_ONLY = 0x01
+FILTER_RANGE = 0x02
+FILTER_EVERY_N = 0x04
+FILTER_DELTA = 0x08
+
+# struct simtemp_filter: mode, min_mC, max_mC, every_n, delta_mC, reserved
+FILTER_FORMAT = '<IiiIII'
+
+# _IOC(dir, 'S', nr, size) as built by <linux/ioctl.h>. dir: 1 = write, 2 = read
+def _ioc(direction, nr, size):
+    return (direction << 30) | (size << 16) | (ord('S') << 8) | nr
+
+SIMTEMP_IOC_SET_FILTER = _ioc(1, 1, struct.calcsize(FILTER_FORMAT))
+SIMTEMP_IOC_GET_FILTER = _ioc(2, 2, struct.calcsize(FILTER_FORMAT))
+
+# Delivery mode of one open file (SIMTEMP_DELIVERY_*): shared queue or every sample (fan-out)
+DELIVERY_SHARED = 0
+DELIVERY_BROADCAST = 1
+SIMTEMP_IOC_SET_DELIVERY = _ioc(1, 7, 4)
+
+# Non-destructive history query (struct simtemp_history): mode, count, since_seq, samples, available, lost, next_seq
+HISTORY_LAST = 0
+HISTORY_SINCE = 1
+HISTORY_FORMAT = '<IIQQIIQ'
+SIMTEMP_IOC_GET_HISTORY = _ioc(3, 10, struct.calcsize(HISTORY_FORMAT))
+
 # --- Auxiliar Functions Definitions ---
 
 # Configuration Writing: Control Interface
@@ -61,9 +99,48 @@ def write_sysfs(attribute, value):
 
 
 
+# Server side filter: only the samples accepted by the Driver wake and are copied to this fd.
+# fd: file descriptor from /dev/simtemp
+# args: --alert-only, --range, --every and --delta options
+def set_filter(fd, args):
+    """Install the per-file filter of fd through SIMTEMP_IOC_SET_FILTER. Returns the mode installed."""
+    mode = 0
+    min_mC, max_mC, every_n, delta_mC = 0, 0, 0, 0
+
+    if args.alert_only:
+        mode |= FILTER_ALERT_ONLY
+    if args.range:
+        mode |= FILTER_RANGE
+        min_mC, max_mC = args.range
+    if args.every:
+        mode |= FILTER_EVERY_N
+        every_n = args.every
+    if args.delta is not None:
+        mode |= FILTER_DELTA
+        delta_mC = args.delta
+
+    if mode:
+        fcntl.ioctl(fd, SIMTEMP_IOC_SET_FILTER, struct.pack(FILTER_FORMAT, mode, min_mC, max_mC, every_n, delta_mC, 0))
+    return mode
+
+
+# History query: copies samples of the history window without consuming them (SIMTEMP_IOC_GET_HISTORY).
+# mode: HISTORY_LAST (the newest 'count') or HISTORY_SINCE (from sequence since_seq on, oldest first)
+# Returns (samples as (timestamp_ns, temp_mC, flags) tuples, available, lost, next_seq to continue with HISTORY_SINCE)
+def get_history(fd, mode, count, since_seq=0):
+    buf = ctypes.create_string_buffer(count * SAMPLE_SIZE)
+    arg = bytearray(struct.pack(HISTORY_FORMAT, mode, count, since_seq, ctypes.addressof(buf), 0, 0, 0))
+    fcntl.ioctl(fd, SIMTEMP_IOC_GET_HISTORY, arg, True)
+    _, copied, _, _, available, lost, next_seq = struct.unpack(HISTORY_FORMAT, arg)
+    samples = [struct.unpack_from(STRUCT_FORMAT, buf, i * SAMPLE_SIZE) for i in range(copied)]
+    return samples, available, lost, next_seq
+
+
 # fd: file descriptor from /dev/simtemp
 # fd---struct file *file---- file->private_data------struct nxp_simtemp_dev
-def read_and_print_sample(fd):
+# printed: timestamps already printed by the history backfill. The queue overlaps the backfill only at its head, so
+# they are skipped until the first sample that is not one of them (exact match: CLOCK_REALTIME may step backwards)
+def read_and_print_sample(fd, printed=None):
     """Read and process an Binary Register from kernel."""
     try:
         # Call to system syscall 'read()' to fd and size of data from Driver
@@ -77,20 +154,31 @@ def read_and_print_sample(fd):
         # Data Validation
         # Unpacking data
         timestamp_ns, temp_mC, flags = struct.unpack(STRUCT_FORMAT, data)
-        temp_C = temp_mC / TEMP_DIVISOR
-        timestamp_sec = timestamp_ns / 1_000_000_000.0  
-        
-        # ISO 8601 Time Zone 'Z'
-        date_time = datetime.fromtimestamp(timestamp_sec, tz=timezone.utc).isoformat().replace('+00:00', 'Z')
-
-        #Isolation of Alert Bit from flags
-        alert_status = 1 if (flags & FLAG_THRESHOLD_CROSSED) else 0
-
-        print(f"{date_time} temp={temp_C:.1f}C alert={alert_status} | KERNEL FLAGS: {flags}")
+        if printed:
+            if timestamp_ns in printed:
+                return True
+            printed.clear()
+        print_sample(timestamp_ns, temp_mC, flags)
         return True
     except Exception:
         return False
+
+
+def print_sample(timestamp_ns, temp_mC, flags):
+    """Prints one sample (timestamp, temperature, alert and levels)."""
+    temp_C = temp_mC / TEMP_DIVISOR
+    timestamp_sec = timestamp_ns / 1_000_000_000.0  
     
+    # ISO 8601 Time Zone 'Z'
+    date_time = datetime.fromtimestamp(timestamp_sec, tz=timezone.utc).isoformat().replace('+00:00', 'Z')
+
+    #Isolation of Alert Bit from flags
+    alert_status = 1 if (flags & FLAG_THRESHOLD_CROSSED) else 0
+    levels = (flags >> LEVEL_SHIFT) & LEVEL_MASK
+
+    print(f"{date_time} temp={temp_C:.1f}C alert={alert_status} levels={levels:#x} | KERNEL FLAGS: {flags}")
+
+
 # --- Operation Mode 1 :Continuous Monitoring (Asynchronous Reading) ---
 
 def cli_monitor_mode(args):
@@ -109,6 +197,37 @@ def cli_monitor_mode(args):
         print(f"Error: File could not be opened {DEVICE_PATH}.", file=sys.stderr)
         sys.exit(1)
 
+    # Optional server side filter and broadcast delivery for this fd
+    try:
+        if args.broadcast:
+            fcntl.ioctl(fd, SIMTEMP_IOC_SET_DELIVERY, struct.pack('<I', DELIVERY_BROADCAST))
+            print("Broadcast delivery: every sample is received, other readers are not affected.")
+        if set_filter(fd, args):
+            print("Server side filter installed.")
+    except OSError as e:
+        print(f"Error: Filter could not be installed: {e}", file=sys.stderr)
+        os.close(fd)
+        sys.exit(1)
+
+    # History backfill: the recent samples are printed at once instead of waiting several periods.
+    # The ones also queued for read() are skipped, so nothing is printed twice.
+    printed = set()
+    if args.history or args.since_seq is not None:
+        try:
+            if args.since_seq is not None:
+                samples, available, lost, next_seq = get_history(fd, HISTORY_SINCE, args.history or 4096, args.since_seq)
+            else:
+                samples, available, lost, next_seq = get_history(fd, HISTORY_LAST, args.history)
+        except OSError as e:
+            print(f"Error: History could not be read: {e}", file=sys.stderr)
+            os.close(fd)
+            sys.exit(1)
+        print(f"--- history: {len(samples)} samples (window {available}, lost {lost}, next seq {next_seq}) ---")
+        for sample in samples:
+            print_sample(*sample)
+        printed.update(sample[0] for sample in samples)
+        print("--- live ---")
+
     # Waiting Event
     # Creation of objects Poll and Epoll.
     poller = select.poll()
@@ -148,7 +267,7 @@ def cli_monitor_mode(args):
                             
                             try:
                                 #if reads 0bytes through implementation of os.read()
-                                if not read_and_print_sample(fd):
+                                if not read_and_print_sample(fd, printed):
                                     break 
                             
                             # Ring Buffer is empty when os.read(O_NONBLOCK)
@@ -244,6 +363,272 @@ def cli_test_mode(args):
     sys.exit(1) # Fail Code
 
 
+# --- Operation Mode 3: Live Reconfiguration Test (T5, measured) ---
+
+# Reads one counter from /sys/.../stats, e.g. read_stat("updates")
+def read_stat(name):
+    with open(os.path.join(SYSFS_BASE_PATH, "stats")) as f:
+        for line in f:
+            key, _, value = line.partition('=')
+            if key.strip() == name:
+                return int(value.strip().split()[0])
+    return 0
+
+
+def read_sysfs(attribute):
+    with open(os.path.join(SYSFS_BASE_PATH, attribute)) as f:
+        return f.read().strip()
+
+
+# Drains the queue of fd until the producer counter is stable around the drain.
+# Returns (updates, timestamps drained), so samples produced vs samples read can be compared exactly.
+def quiesce(fd):
+    drained = []
+    while True:
+        before = read_stat("updates")
+        while True:
+            try:
+                data = os.read(fd, SAMPLE_SIZE * 32)
+            except BlockingIOError:
+                break
+            if not data:
+                break
+            for off in range(0, len(data) - SAMPLE_SIZE + 1, SAMPLE_SIZE):
+                drained.append(struct.unpack_from(STRUCT_FORMAT, data, off)[0])
+        if read_stat("updates") == before:
+            return before, drained
+
+
+def cli_reconfig_test_mode(args):
+    """Writes sampling_ms/threshold_mC in a loop under full read load and measures the stream."""
+    iterations = args.reconfig_test
+    periods_ms = [10, 20, 50]
+    thresholds_mC = [20000, 45000, 70000]
+
+    old_sampling = read_sysfs("sampling_ms")
+    old_threshold = read_sysfs("threshold_mC")
+
+    fd = os.open(DEVICE_PATH, os.O_RDONLY | os.O_NONBLOCK)
+    write_sysfs("sampling_ms", periods_ms[0])
+    time.sleep(0.2)
+
+    updates_start, _ = quiesce(fd)
+    timestamps = []
+    stop = threading.Event()
+
+    # Reader: consumes every sample as soon as it is produced (full read load)
+    def reader():
+        poller = select.poll()
+        poller.register(fd, select.POLLIN)
+        while not stop.is_set():
+            if not poller.poll(100):
+                continue
+            try:
+                data = os.read(fd, SAMPLE_SIZE * 32)
+            except BlockingIOError:
+                continue
+            for off in range(0, len(data) - SAMPLE_SIZE + 1, SAMPLE_SIZE):
+                timestamps.append(struct.unpack_from(STRUCT_FORMAT, data, off)[0])
+
+    thread = threading.Thread(target=reader)
+    thread.start()
+
+    # Writer: period and threshold changes while the producer runs
+    # Each attribute is timed on its own: a slow write of one of them must show up in its max
+    latencies = {"sampling_ms": [], "threshold_mC": []}
+    for i in range(iterations):
+        for attr, value in (("sampling_ms", periods_ms[i % len(periods_ms)]),
+                            ("threshold_mC", thresholds_mC[i % len(thresholds_mC)])):
+            t0 = time.monotonic_ns()
+            write_sysfs(attr, value)
+            latencies[attr].append(time.monotonic_ns() - t0)
+        time.sleep(0.005)
+
+    stop.set()
+    thread.join()
+    updates_end, drained = quiesce(fd)
+    timestamps.extend(drained)
+    os.close(fd)
+
+    write_sysfs("sampling_ms", old_sampling)
+    write_sysfs("threshold_mC", old_threshold)
+
+    # Duplicated or reordered samples: timestamps must be strictly increasing
+    duplicates = sum(1 for a, b in zip(timestamps, timestamps[1:]) if b <= a)
+    max_gap_ms = max((b - a for a, b in zip(timestamps, timestamps[1:])), default=0) / 1e6
+    produced = updates_end - updates_start
+    lost = produced - len(timestamps)
+    # A period change is applied at the next expiry: one old period plus one new period at most
+    gap_limit_ms = 2 * max(periods_ms) * 1.5
+
+    print(f"--- RECONFIG TEST: {iterations} writes of sampling_ms and threshold_mC ---")
+    print(f"produced={produced} read={len(timestamps)} lost={lost} duplicates={duplicates}")
+    print(f"max gap={max_gap_ms:.2f}ms (limit {gap_limit_ms:.0f}ms)")
+    for attr, lat in latencies.items():
+        print(f"{attr} write latency: avg={sum(lat) / len(lat) / 1000:.1f}us max={max(lat) / 1000:.1f}us")
+    print(f"config updates={read_stat('config updates')}")
+
+    if lost == 0 and duplicates == 0 and max_gap_ms <= gap_limit_ms:
+        print("--- SUCCESS: no sample lost or duplicated, no gap in the stream.")
+        sys.exit(0)
+
+    print("--- FAIL: the stream was disturbed by the reconfiguration.")
+    sys.exit(1)
+
+
+# --- Operation Mode 4: Alert Latency Probe (SLO) ---
+
+# Thresholds used to force a crossing: every sample exceeds PROBE_LOW_mC and none exceeds PROBE_HIGH_mC
+PROBE_LOW_mC = 0
+PROBE_HIGH_mC = 1000000
+
+# Histogram upper bounds in microseconds (same buckets as the native consumer, main.c)
+PROBE_BUCKETS_US = [10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000]
+
+# Native consumer built from main.c ("make" in user/cli)
+PROBE_NATIVE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "simtemp_probe")
+
+
+# Nearest rank percentile of a sorted list
+def percentile(values, p):
+    return values[min(len(values) - 1, int(p * len(values) / 100))]
+
+
+def print_latency_report(poll_us, read_us):
+    """Prints p50/p99/max of both latencies and the histogram of the read() latency."""
+    poll_us.sort()
+    read_us.sort()
+
+    print(f"{'latency (us)':<14} {'p50':>9} {'p99':>9} {'max':>9}")
+    for name, values in (("POLLPRI", poll_us), ("read()", read_us)):
+        print(f"{name:<14} {percentile(values, 50):>9.1f} {percentile(values, 99):>9.1f} {values[-1]:>9.1f}")
+
+    print("histogram of sample.timestamp_ns -> read() return:")
+    counts = [0] * (len(PROBE_BUCKETS_US) + 1)
+    for value in read_us:
+        i = 0
+        while i < len(PROBE_BUCKETS_US) and value >= PROBE_BUCKETS_US[i]:
+            i += 1
+        counts[i] += 1
+
+    for i, count in enumerate(counts):
+        label = f"< {PROBE_BUCKETS_US[i]}us" if i < len(PROBE_BUCKETS_US) else f">= {PROBE_BUCKETS_US[-1]}us"
+        bar = '#' * ((count * 50 + len(read_us) - 1) // len(read_us))
+        print(f"  {label:>10} {count:>7} {bar}")
+
+
+# Empties the queue of fd (O_NONBLOCK)
+def drain(fd):
+    while True:
+        try:
+            if not os.read(fd, SAMPLE_SIZE * 32):
+                return
+        except BlockingIOError:
+            return
+
+
+def cli_probe_mode(args):
+    """Forces threshold crossings and measures sample.timestamp_ns -> POLLPRI and -> read() return."""
+    if args.native:
+        # Same probe with a C consumer: no interpreter between the wakeup and the measurement
+        argv = [PROBE_NATIVE, "-d", DEVICE_PATH, "-s", SYSFS_BASE_PATH, "-n", str(args.probe)]
+        if args.sampling_ms:
+            argv += ["-p", str(args.sampling_ms)]
+        if args.broadcast:
+            argv.append("-b")
+        if args.slo_us:
+            argv += ["-l", str(args.slo_us)]
+        try:
+            os.execv(PROBE_NATIVE, argv)
+        except OSError as e:
+            print(f"Error: {PROBE_NATIVE} could not be executed ({e}). Build it with 'make' in user/cli.", file=sys.stderr)
+            sys.exit(1)
+
+    events = args.probe
+    old_sampling = read_sysfs("sampling_ms")
+    old_threshold = read_sysfs("threshold_mC")
+    if args.sampling_ms:
+        write_sysfs("sampling_ms", args.sampling_ms)
+    # An event waits one sample at most: one period plus a margin for the scheduling of this process
+    timeout_ms = 2 * int(read_sysfs("sampling_ms")) + 1000
+
+    fd = os.open(DEVICE_PATH, os.O_RDONLY | os.O_NONBLOCK)
+    if args.broadcast:
+        fcntl.ioctl(fd, SIMTEMP_IOC_SET_DELIVERY, struct.pack('<I', DELIVERY_BROADCAST))
+
+    poller = select.poll()
+    poller.register(fd, select.POLLPRI)
+
+    print(f"--- ALERT LATENCY PROBE: {events} threshold crossings "
+          f"(sampling_ms={read_sysfs('sampling_ms')}, {'broadcast' if args.broadcast else 'shared'} delivery, Python consumer) ---")
+
+    poll_us, read_us = [], []
+    missed, repeated = 0, 0
+    try:
+        while len(read_us) + missed < events:
+            # Disarm: no sample exceeds the threshold, pending alerts and queued samples are discarded
+            write_sysfs("threshold_mC", PROBE_HIGH_mC)
+            write_sysfs("clear_alert", 1)
+            drain(fd)
+
+            # Arm: the next sample produced crosses the threshold. Older samples are not part of this event.
+            armed_ns = time.time_ns()
+            write_sysfs("threshold_mC", PROBE_LOW_mC)
+
+            alert_ts = None
+            while alert_ts is None:
+                if not poller.poll(timeout_ms):
+                    break
+                poll_ns = time.time_ns()
+
+                try:
+                    data = os.read(fd, SAMPLE_SIZE * 32)
+                except BlockingIOError:
+                    continue
+                read_ns = time.time_ns()
+
+                for off in range(0, len(data) - SAMPLE_SIZE + 1, SAMPLE_SIZE):
+                    timestamp_ns, _, flags = struct.unpack_from(STRUCT_FORMAT, data, off)
+                    if (flags & FLAG_THRESHOLD_CROSSED) and timestamp_ns >= armed_ns:
+                        alert_ts = timestamp_ns
+                        break
+
+            if alert_ts is None:
+                missed += 1
+                continue
+
+            # The POLLPRI came from a sample produced before the arm and the alert sample arrived in the same read():
+            # the wakeup of this event was not observed, the event is repeated
+            if poll_ns < alert_ts:
+                repeated += 1
+                continue
+
+            poll_us.append((poll_ns - alert_ts) / 1000)
+            read_us.append((read_ns - alert_ts) / 1000)
+    except KeyboardInterrupt:
+        print("\nProbe stopped by User.")
+    finally:
+        os.close(fd)
+        write_sysfs("threshold_mC", old_threshold)
+        if args.sampling_ms:
+            write_sysfs("sampling_ms", old_sampling)
+        write_sysfs("clear_alert", 1)
+
+    if not read_us:
+        print("--- FAIL: no threshold alert was delivered.")
+        sys.exit(1)
+
+    print_latency_report(poll_us, read_us)
+    print(f"events={len(read_us)} missed={missed} repeated={repeated}")
+
+    if missed or (args.slo_us and percentile(read_us, 99) > args.slo_us):
+        print(f"--- FAIL: {missed} alerts missed, p99 limit {args.slo_us}us.")
+        sys.exit(1)
+
+    print("--- SUCCESS: every forced crossing was delivered.")
+    sys.exit(0)
+
+
 # --- Main Entry Point ---
 
 if __name__ == "__main__":
@@ -255,17 +640,39 @@ if __name__ == "__main__":
     parser.add_argument('--sampling-ms', type=int, help='Set sampling period in milliseconds via sysfs.')
     parser.add_argument('--threshold-mC', type=int, help='Set alert threshold in milli-Celsius via sysfs.')
     parser.add_argument('--test', action='store_true', help='Run threshold test mode and exit with success/failure code.')
+    parser.add_argument('--levels', type=str, help='Set the threshold table via sysfs, e.g. "45000:1000 55000:1000 65000:500".')
+    parser.add_argument('--alert-only', action='store_true', help='Monitor: only receive samples with the threshold alert flag.')
+    parser.add_argument('--range', type=int, nargs=2, metavar=('MIN_mC', 'MAX_mC'), help='Monitor: only receive samples within [MIN_mC, MAX_mC].')
+    parser.add_argument('--every', type=int, metavar='N', help='Monitor: only receive one of every N samples.')
+    parser.add_argument('--delta', type=int, metavar='mC', help='Monitor: only receive samples that changed more than mC.')
+    parser.add_argument('--broadcast', action='store_true', help='Monitor: receive every sample even if other processes read the device (fan-out).')
+    parser.add_argument('--history', type=int, metavar='N', help='Monitor: print the last N samples of the history window first (not consumed).')
+    parser.add_argument('--since-seq', type=int, metavar='SEQ', help="Monitor: print the samples of the history window from sequence SEQ on first (the 'next seq' of a previous run: reconnect catch-up).")
+    parser.add_argument('--probe', type=int, nargs='?', const=1000, metavar='N', help='Force N threshold crossings and report the latency sample -> POLLPRI -> read() (default 1000).')
+    parser.add_argument('--native', action='store_true', help='Probe: use the C consumer (user/cli/simtemp_probe) instead of Python.')
+    parser.add_argument('--slo-us', type=int, metavar='US', help='Probe: fail when the p99 read() latency exceeds US microseconds.')
+    parser.add_argument('--reconfig-test', type=int, nargs='?', const=100, metavar='N', help='Run N live reconfigurations under read load and measure lost/duplicated samples (default 100).')
 
     args = parser.parse_args()
+    if args.probe is not None and args.probe < 1:
+        parser.error("--probe needs at least 1 threshold crossing")
+    if args.since_seq is not None and args.since_seq < 0:
+        parser.error("--since-seq takes a sequence number (0 or more)")
 
     if args.test:
         cli_test_mode(args)
+    elif args.reconfig_test:
+        cli_reconfig_test_mode(args)
+    elif args.probe is not None:
+        cli_probe_mode(args)
     else:
         # Aplicar configuraciones antes de iniciar el monitoreo continuo
         if args.sampling_ms:
             write_sysfs("sampling_ms", args.sampling_ms)
         if args.threshold_mC:
             write_sysfs("threshold_mC", args.threshold_mC)
+        if args.levels:
+            write_sysfs("levels", args.levels)
         
         # Iniciar monitoreo
         cli_monitor_mode(args)
@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+# emu_check.py: High-rate consumer check of the emulator (make check).
+# Reads SIMTEMP_DEVICE for SECONDS with batched read() calls and verifies that every sample
+# arrives once, in order and on the period grid of 'rate_hz'. Exit code: 0 success, 1 fail.
+
+import os
+import struct
+import sys
+import time
+
+SAMPLE_SIZE = 16
+STRUCT_FORMAT = '<QiI'
+BATCH = 256
+
+def main():
+    device = os.environ.get("SIMTEMP_DEVICE", "/dev/simtemp")
+    sysfs = os.environ.get("SIMTEMP_SYSFS", "/sys/devices/platform/nxp_simtemp")
+    seconds = float(sys.argv[1]) if len(sys.argv) > 1 else 2.0
+
+    with open(os.path.join(sysfs, "rate_hz")) as f:
+        rate = int(f.read())
+    period_ns = 1000000000 // rate
+
+    # Samples left in the ring by a previous reader (other rate) are discarded first
+    fd = os.open(device, os.O_RDONLY | os.O_NONBLOCK)
+    try:
+        while os.read(fd, SAMPLE_SIZE * BATCH):
+            pass
+    except BlockingIOError:
+        pass
+    os.set_blocking(fd, True)
+
+    received = lost = disorder = 0
+    last_ts = None
+    end = time.monotonic() + seconds
+
+    while time.monotonic() < end:
+        data = os.read(fd, SAMPLE_SIZE * BATCH)
+        for off in range(0, len(data), SAMPLE_SIZE):
+            ts, temp, flags = struct.unpack_from(STRUCT_FORMAT, data, off)
+            if last_ts is not None:
+                step = ts - last_ts
+                if step <= 0 or step % period_ns:
+                    disorder += 1
+                else:
+                    lost += step // period_ns - 1
+            last_ts = ts
+            received += 1
+    os.close(fd)
+
+    print(f"received={received} lost={lost} out_of_order={disorder} rate={received / seconds:.0f}/s (rate_hz={rate})")
+    return 0 if received and disorder == 0 and lost == 0 else 1
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,1658 @@
+/***************************************************************************
+	Open Source License 2025 NXP Semiconductor Challenge Stage
+****************************************************************************
+* Title        : simtemp_emu.c
+* Description  : User Space emulator of /dev/simtemp and its sysfs controls (FUSE/CUSE)
+*                for consumer tests without building or loading nxp_simtemp.ko
+*
+* Environment  : C Language (User Space)
+*
+* Responsible  : Daniel R Miranda [danielrmirandacortes@gmail.com]
+*
+* Guidelines   : Linux Kernel Coding Style
+*
+*
+* The emulator speaks the FUSE protocol of the kernel directly (<linux/fuse.h>, no libfuse):
+*   <mount>/simtemp        data file: read()/poll()/POLLPRI contract and 16-byte struct simtemp_sample
+*   <mount>/sysfs/<attr>   sysfs-like controls (sampling_ms, threshold_mC, levels, stats, ...)
+*                          a store that the driver rejects fails here with the same errno
+*   /dev/<name>            (-c) the same data path as a real character device through CUSE
+*
+* The producer follows the driver: ring of 32 samples that overwrites the oldest one, shared
+* queue (one pending read() served per sample batch), threshold levels with hysteresis and
+* lazy start on the first open. 'rate_hz' (emulator only) sets rates up to 100 kHz: the samples
+* due since the last wakeup are produced together, each one with its own timestamp on the grid.
+* Per-file ioctls (filters, delivery mode) and SIMTEMP_IOC_GET_HISTORY are not emulated and return ENOTTY:
+* 'history_len' keeps the length with the driver rules, but no window of samples is kept behind it.
+*
+*   simtemp_emu -m /tmp/simtemp                      //SIMTEMP_DEVICE=/tmp/simtemp/simtemp
+*   simtemp_emu -m /tmp/simtemp -r 100000 -b 1024    //SIMTEMP_SYSFS=/tmp/simtemp/sysfs
+*   simtemp_emu -m /tmp/simtemp -c simtemp_emu       //plus /dev/simtemp_emu (needs /dev/cuse)
+*
+****************************************************************************
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* * * * * * * * * * * Header Files *   *   *   *   *   *   *   *   *   *   *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/mount.h>
+#include <sys/signalfd.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
+#include <linux/fuse.h>
+
+#include "../../kernel/nxp_simtemp_ioctl.h"    //User/Kernel Contract: struct simtemp_sample, flags and levels
+
+#define EMU_RING_DEFAULT    32              //RING_BUFFER_SIZE of the driver
+#define EMU_MAX_RATE_HZ     100000          //Highest rate accepted by 'rate_hz'
+#define EMU_MIN_TICK_NS     50000ULL        //The producer wakes at most every 50 us, faster rates produce several samples per wakeup
+#define EMU_MAX_FILES       256             //Open files of the data path
+#define EMU_MAX_PENDING     256             //Blocked read() calls waiting for samples
+#define EMU_MAX_READ        (64 * 1024)     //Largest read() answered at once (4096 samples)
+#define EMU_MAX_WRITE       4096            //Largest store of an attribute (PAGE_SIZE of sysfs)
+#define EMU_REQ_BUFFER      (EMU_MAX_WRITE + FUSE_MIN_READ_BUFFER)
+#define EMU_ATTR_SIZE       4096            //st_size reported for the attributes, as sysfs does
+#define EMU_HISTORY_DEFAULT 256             //SIMTEMP_HISTORY_DEFAULT of the driver
+#define EMU_HISTORY_MAX     65536           //SIMTEMP_HISTORY_MAX of the driver
+
+//Inodes of the mount: / , /simtemp , /sysfs and one per attribute
+enum
+{
+    EMU_INO_ROOT = FUSE_ROOT_ID,
+    EMU_INO_DATA,
+    EMU_INO_SYSFS,
+    EMU_INO_ATTR0,
+};
+
+
+//------------- Data Structure:  Emulated Device   ----------------------------------------
+struct emu_file             //Open file of the data path (FUSE or CUSE)
+{
+    bool                        used;
+    bool                        poll_armed;     //The kernel asked for a wakeup notification (FUSE_POLL_SCHEDULE_NOTIFY)
+    int                         fd;             //Session (/dev/fuse or /dev/cuse) the notification is sent to
+    uint64_t                    kh;             //Poll handle of the kernel
+};
+
+struct emu_read             //read() blocked in the kernel until a sample arrives (its reply is deferred)
+{
+    int                         fd;
+    uint64_t                    unique;
+    uint32_t                    size;
+};
+
+struct emu_dev
+{
+    //Ring Buffer (same overwrite policy as simtemp_buffer_push())
+    struct simtemp_sample       *ring;
+    uint32_t                    ring_size;
+    uint32_t                    head;
+    uint32_t                    tail;
+    uint32_t                    count;
+
+    //Configuration
+    uint64_t                    period_ns;
+    int32_t                     sampling_ms;
+    bool                        aligned;        //'timer_mode': expiries on multiples of the period
+    uint32_t                    history_len;    //'history_len' (power of two, 0 disabled); GET_HISTORY is not emulated
+    uint32_t                    nr_levels;
+    struct
+    {
+	int32_t                 threshold_mC;
+	uint32_t                hysteresis_mC;
+	uint32_t                alerts;
+	uint64_t                alerts_total;   //Never decremented nor reset (stats_bin counter)
+	bool                    active;
+    } levels[SIMTEMP_MAX_LEVELS];
+
+    //Statistics ('stats')
+    uint32_t                    alerts_count;
+    uint32_t                    updates_count;
+    uint64_t                    overflows;      //Samples overwritten before a read() took them (emulator only)
+    uint64_t                    cfg_updates;
+    uint64_t                    timer_fires;
+    uint64_t                    jitter_last_ns;
+    uint64_t                    jitter_max_ns;
+    uint64_t                    jitter_sum_ns;
+    int                         producer_cpu;
+
+    //Lazy Producer
+    uint32_t                    users;
+    bool                        always_on;
+    bool                        running;
+    int                         tfd;            //timerfd (CLOCK_MONOTONIC) of the producer
+    uint64_t                    next_ns;        //Monotonic time of the next sample
+    uint64_t                    armed_ns;       //Expiry programmed in the timerfd (jitter reference)
+    uint64_t                    real_offset_ns; //CLOCK_REALTIME - CLOCK_MONOTONIC when the producer started
+
+    //CPU affinity ('producer_cpus')
+    cpu_set_t                   cpus;
+    cpu_set_t                   cpus_default;   //Affinity at start, restored by an empty list
+    bool                        pinned;
+
+    uint32_t                    rng;            //xorshift32 state of the temperature generator
+
+    //Sessions and open files
+    int                         fuse_fd;
+    int                         cuse_fd;
+    struct emu_file             files[EMU_MAX_FILES];
+    struct emu_read             pending[EMU_MAX_PENDING];
+    uint32_t                    nr_pending;
+    time_t                      start_time;
+};
+
+static struct emu_dev emu;
+static struct simtemp_sample emu_batch[EMU_MAX_READ / sizeof(struct simtemp_sample)];
+
+
+//------------- Data Structure:  sysfs-like Attributes   ----------------------------------------
+struct emu_attr
+{
+    const char                  *name;
+    mode_t                      mode;
+    int                         (*show)(char *buf, size_t size);                //Returns the length of the text
+    int                         (*store)(const char *buf);                      //Returns 0 or -errno (as the sysfs store of the driver)
+};
+
+
+// ---------------------- (Time and Random Helpers)  ---------------------------------------
+static uint64_t emu_clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint32_t emu_random(void)
+{
+    uint32_t x = emu.rng;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    emu.rng = x;
+
+    return x;
+}
+
+
+// ---------------------- (Ring Buffer)  ---------------------------------------
+static void emu_push(const struct simtemp_sample *sample)
+{
+    if (emu.count == emu.ring_size)
+    {
+	emu.tail = (emu.tail + 1) % emu.ring_size;     //Overwrite: the oldest sample is lost
+	emu.count--;
+	emu.overflows++;
+    }
+
+    emu.ring[emu.head] = *sample;
+    emu.head = (emu.head + 1) % emu.ring_size;
+    emu.count++;
+}
+
+static bool emu_pop(struct simtemp_sample *sample)
+{
+    if (emu.count == 0)
+    {
+	return false;
+    }
+
+    *sample = emu.ring[emu.tail];
+    emu.tail = (emu.tail + 1) % emu.ring_size;
+    emu.count--;
+
+    return true;
+}
+
+
+// ---------------------- (Threshold Levels, same rules as simtemp_levels_*())  ------------------------
+static uint32_t emu_levels_update(int32_t temp_mC)
+{
+    uint32_t mask = 0;
+    uint32_t i;
+
+    for (i = 0; i < emu.nr_levels; i++)
+    {
+	if (temp_mC > emu.levels[i].threshold_mC)
+	{
+	    emu.levels[i].active = true;
+	}
+	else if ((int64_t)temp_mC <= (int64_t)emu.levels[i].threshold_mC - emu.levels[i].hysteresis_mC)
+	{
+	    emu.levels[i].active = false;
+	}
+
+	if (emu.levels[i].active)
+	{
+	    mask |= 1U << i;
+	    emu.levels[i].alerts++;
+	    emu.levels[i].alerts_total++;
+	}
+    }
+
+    return mask;
+}
+
+static uint32_t emu_levels_pending(void)
+{
+    uint32_t mask = 0;
+    uint32_t i;
+
+    for (i = 0; i < SIMTEMP_MAX_LEVELS; i++)
+    {
+	if (emu.levels[i].alerts)
+	{
+	    mask |= 1U << i;
+	}
+    }
+
+    return mask;
+}
+
+static void emu_levels_ack(uint32_t flags)
+{
+    uint32_t mask = SIMTEMP_LEVEL_FLAGS(flags);
+    uint32_t i;
+
+    for (i = 0; i < SIMTEMP_MAX_LEVELS; i++)
+    {
+	if ((mask & (1U << i)) && emu.levels[i].alerts > 0)
+	{
+	    emu.levels[i].alerts--;
+	}
+    }
+}
+
+//A new table restarts the hysteresis state and clears the alerts of the levels out of use
+static void emu_levels_restart(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < SIMTEMP_MAX_LEVELS; i++)
+    {
+	emu.levels[i].active = false;
+	if (i >= emu.nr_levels)
+	{
+	    emu.levels[i].alerts = 0;
+	}
+    }
+}
+
+
+// ---------------------- (FUSE Replies)  ---------------------------------------
+static void emu_reply(int fd, uint64_t unique, int error, const void *data, size_t len)
+{
+    struct fuse_out_header out = {
+	.len = sizeof(out) + (error ? 0 : len),
+	.error = error,
+	.unique = unique,
+    };
+    struct iovec iov[2] = {
+	{ .iov_base = &out, .iov_len = sizeof(out) },
+	{ .iov_base = (void *)data, .iov_len = error ? 0 : len },
+    };
+
+    //ENOENT: the request was interrupted and already completed by the kernel, nothing to do
+    if (writev(fd, iov, (error || !len) ? 1 : 2) < 0 && errno != ENOENT)
+    {
+	perror("simtemp_emu: reply");
+    }
+}
+
+//Wakes the poll()/select()/epoll() waiters of every open file that asked for it
+static void emu_notify_pollers(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < EMU_MAX_FILES; i++)
+    {
+	struct emu_file *file = &emu.files[i];
+
+	if (file->used && file->poll_armed)
+	{
+	    struct fuse_notify_poll_wakeup_out arg = { .kh = file->kh };
+	    struct fuse_out_header out = {
+		.len = sizeof(out) + sizeof(arg),
+		.error = FUSE_NOTIFY_POLL,
+		.unique = 0,
+	    };
+	    struct iovec iov[2] = {
+		{ .iov_base = &out, .iov_len = sizeof(out) },
+		{ .iov_base = &arg, .iov_len = sizeof(arg) },
+	    };
+
+	    file->poll_armed = false;
+	    if (writev(file->fd, iov, 2) < 0 && errno != ENOENT)
+	    {
+		perror("simtemp_emu: poll notify");
+	    }
+	}
+    }
+}
+
+
+// ---------------------- (Data Path: read() and poll())  ---------------------------------------
+
+//Pops the samples that fit in 'size' and acknowledges their alerts, as the shared queue of read() does
+static void emu_reply_samples(int fd, uint64_t unique, uint32_t size)
+{
+    uint32_t max = size / sizeof(struct simtemp_sample);
+    uint32_t n = 0;
+
+    if (max > sizeof(emu_batch) / sizeof(emu_batch[0]))
+    {
+	max = sizeof(emu_batch) / sizeof(emu_batch[0]);
+    }
+
+    while (n < max && emu_pop(&emu_batch[n]))
+    {
+	if ((emu_batch[n].flags & TRESHOLD_CROSSED) && emu.alerts_count > 0)
+	{
+	    emu.alerts_count--;
+	    emu_levels_ack(emu_batch[n].flags);
+	}
+	n++;
+    }
+
+    emu_reply(fd, unique, 0, emu_batch, n * sizeof(emu_batch[0]));
+}
+
+static void emu_data_read(int fd, uint64_t unique, const struct fuse_read_in *arg)
+{
+    if (arg->size < sizeof(struct simtemp_sample))
+    {
+	emu_reply(fd, unique, -EINVAL, NULL, 0);   //Buffer too small for one sample, as the driver
+	return;
+    }
+
+    if (emu.count)
+    {
+	emu_reply_samples(fd, unique, arg->size);
+	return;
+    }
+
+    if (arg->flags & O_NONBLOCK)
+    {
+	emu_reply(fd, unique, -EAGAIN, NULL, 0);
+	return;
+    }
+
+    if (emu.nr_pending == EMU_MAX_PENDING)
+    {
+	emu_reply(fd, unique, -ENOMEM, NULL, 0);
+	return;
+    }
+
+    //Blocking read(): the reply is deferred until the producer pushes a sample
+    emu.pending[emu.nr_pending++] = (struct emu_read){ .fd = fd, .unique = unique, .size = arg->size };
+}
+
+//One blocked read() is served per batch while samples remain (exclusive wakeup of the shared queue)
+static void emu_serve_pending(void)
+{
+    while (emu.nr_pending && emu.count)
+    {
+	struct emu_read rd = emu.pending[0];
+
+	memmove(&emu.pending[0], &emu.pending[1], --emu.nr_pending * sizeof(emu.pending[0]));
+	emu_reply_samples(rd.fd, rd.unique, rd.size);
+    }
+}
+
+//A signal arrived to a blocked reader: its read() returns -EINTR
+static void emu_interrupt(uint64_t unique)
+{
+    uint32_t i;
+
+    for (i = 0; i < emu.nr_pending; i++)
+    {
+	if (emu.pending[i].unique == unique)
+	{
+	    struct emu_read rd = emu.pending[i];
+
+	    memmove(&emu.pending[i], &emu.pending[i + 1], (--emu.nr_pending - i) * sizeof(emu.pending[0]));
+	    emu_reply(rd.fd, rd.unique, -EINTR, NULL, 0);
+	    return;
+	}
+    }
+}
+
+static void emu_data_poll(int fd, uint64_t unique, const struct fuse_poll_in *arg)
+{
+    struct fuse_poll_out out = { 0 };
+
+    if (emu.count)
+    {
+	out.revents |= POLLIN | POLLRDNORM;
+    }
+    if (emu_levels_pending())
+    {
+	out.revents |= POLLPRI;
+    }
+
+    if ((arg->flags & FUSE_POLL_SCHEDULE_NOTIFY) && arg->fh < EMU_MAX_FILES)
+    {
+	emu.files[arg->fh].poll_armed = true;
+	emu.files[arg->fh].fd = fd;
+	emu.files[arg->fh].kh = arg->kh;
+    }
+
+    emu_reply(fd, unique, 0, &out, sizeof(out));
+}
+
+
+// ---------------------- (Producer)  ---------------------------------------
+
+//Next wakeup: when the samples of one batch (at least 50 us of samples) are due
+static void emu_producer_arm(void)
+{
+    uint64_t batch = (EMU_MIN_TICK_NS + emu.period_ns - 1) / emu.period_ns;
+    struct itimerspec its = { 0 };
+
+    emu.armed_ns = emu.next_ns + (batch - 1) * emu.period_ns;
+    its.it_value.tv_sec = emu.armed_ns / 1000000000ULL;
+    its.it_value.tv_nsec = emu.armed_ns % 1000000000ULL;
+    timerfd_settime(emu.tfd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+static void emu_producer_update(void)
+{
+    bool want = emu.users || emu.always_on;
+    uint64_t now;
+
+    if (want == emu.running)
+    {
+	return;
+    }
+
+    emu.running = want;
+    if (!want)
+    {
+	struct itimerspec its = { 0 };
+
+	timerfd_settime(emu.tfd, 0, &its, NULL);   //Disarmed: an idle emulator generates no wakeups
+	return;
+    }
+
+    now = emu_clock_ns(CLOCK_MONOTONIC);
+    emu.real_offset_ns = emu_clock_ns(CLOCK_REALTIME) - now;   //Fixed while running: timestamps stay on the period grid
+    emu.next_ns = emu.aligned ? (now / emu.period_ns + 1) * emu.period_ns : now + emu.period_ns;
+    emu_producer_arm();
+}
+
+//A new period is applied from the next sample on, as the hrtimer callback does
+static void emu_producer_reconfigure(void)
+{
+    emu.cfg_updates++;
+
+    if (emu.running)
+    {
+	if (emu.aligned)
+	{
+	    emu.next_ns = (emu.next_ns + emu.period_ns - 1) / emu.period_ns * emu.period_ns;
+	}
+	emu_producer_arm();
+    }
+}
+
+static void emu_producer_fire(void)
+{
+    uint64_t expirations;
+    uint64_t now, jitter, due;
+    struct simtemp_sample sample;
+
+    if (read(emu.tfd, &expirations, sizeof(expirations)) < 0 || !emu.running)
+    {
+	return;
+    }
+
+    now = emu_clock_ns(CLOCK_MONOTONIC);
+
+    jitter = now > emu.armed_ns ? now - emu.armed_ns : 0;
+    emu.timer_fires++;
+    emu.jitter_last_ns = jitter;
+    emu.jitter_sum_ns += jitter;
+    if (jitter > emu.jitter_max_ns)
+    {
+	emu.jitter_max_ns = jitter;
+    }
+    emu.producer_cpu = sched_getcpu();
+
+    //After a long stall (SIGSTOP, suspend) only the samples the ring can hold are produced, the rest count as overwritten
+    due = (now - emu.next_ns) / emu.period_ns + 1;
+    if (now >= emu.next_ns && due > emu.ring_size)
+    {
+	emu.next_ns += (due - emu.ring_size) * emu.period_ns;
+	emu.overflows += due - emu.ring_size;
+	emu.updates_count += due - emu.ring_size;
+    }
+
+    while (emu.next_ns <= now)
+    {
+	uint32_t level_mask;
+
+	sample.timestamp_ns = emu.next_ns + emu.real_offset_ns;   //Every sample keeps its place on the grid
+	sample.temp_mC = 45000 + (int32_t)(emu_random() % 10000) - 5000;
+	sample.flags = SAMPLE_AVAILABLE;
+
+	level_mask = emu_levels_update(sample.temp_mC);
+	if (level_mask)
+	{
+	    sample.flags |= TRESHOLD_CROSSED | (level_mask << SIMTEMP_LEVEL_SHIFT);
+	    emu.alerts_count++;
+	}
+
+	emu_push(&sample);
+	emu.updates_count++;
+	emu.next_ns += emu.period_ns;
+    }
+
+    emu_serve_pending();
+    emu_notify_pollers();
+    emu_producer_arm();
+}
+
+
+// ---------------------- (sysfs-like Attributes)  ---------------------------------------
+
+//Integer store with the rules of kstrto*(): one optional trailing newline, nothing else
+static int emu_parse_long(const char *buf, long long min, long long max, long long *value)
+{
+    char *end;
+
+    errno = 0;
+    *value = strtoll(buf, &end, 10);
+    if (end == buf || (*end && strcmp(end, "\n")))
+    {
+	return -EINVAL;
+    }
+    if (errno == ERANGE || *value < min || *value > max)
+    {
+	return -ERANGE;
+    }
+
+    return 0;
+}
+
+//The whole store without the trailing newline (sysfs_streq())
+static bool emu_streq(const char *buf, const char *word)
+{
+    size_t len = strlen(word);
+
+    return !strncmp(buf, word, len) && (buf[len] == '\0' || !strcmp(buf + len, "\n"));
+}
+
+static int emu_sampling_ms_show(char *buf, size_t size)
+{
+    return snprintf(buf, size, "%d\n", emu.sampling_ms);
+}
+
+static int emu_sampling_ms_store(const char *buf)
+{
+    long long value;
+    int ret = emu_parse_long(buf, LLONG_MIN, LLONG_MAX, &value);
+
+    if (ret)
+    {
+	return ret;
+    }
+    if (value < 10 || value > INT_MAX)
+    {
+	return -EINVAL;    //Same range as sampling_ms_store()
+    }
+
+    emu.sampling_ms = (int32_t)value;
+    emu.period_ns = (uint64_t)value * 1000000ULL;
+    emu_producer_reconfigure();
+
+    return 0;
+}
+
+static int emu_rate_hz_show(char *buf, size_t size)
+{
+    return snprintf(buf, size, "%llu\n", (unsigned long long)(1000000000ULL / emu.period_ns));
+}
+
+//Emulator only: periods below the 10 ms accepted by sampling_ms ('sampling_ms' then reads the period rounded down)
+static int emu_rate_hz_store(const char *buf)
+{
+    long long value;
+    int ret = emu_parse_long(buf, LLONG_MIN, LLONG_MAX, &value);
+
+    if (ret)
+    {
+	return ret;
+    }
+    if (value < 1 || value > EMU_MAX_RATE_HZ)
+    {
+	return -EINVAL;
+    }
+
+    emu.period_ns = 1000000000ULL / value;
+    emu.sampling_ms = (int32_t)(emu.period_ns / 1000000ULL);
+    emu_producer_reconfigure();
+
+    return 0;
+}
+
+static int emu_threshold_mC_show(char *buf, size_t size)
+{
+    return snprintf(buf, size, "%d\n", emu.levels[0].threshold_mC);
+}
+
+static int emu_threshold_mC_store(const char *buf)
+{
+    long long value;
+    int ret = emu_parse_long(buf, INT32_MIN, INT32_MAX, &value);
+
+    if (ret)
+    {
+	return ret;
+    }
+
+    emu.levels[0].threshold_mC = (int32_t)value;
+    if (emu.nr_levels == 0)
+    {
+	emu.nr_levels = 1;     //Writing the legacy threshold enables level 0 again
+	emu_levels_restart();
+    }
+    emu.cfg_updates++;
+    emu_notify_pollers();
+
+    return 0;
+}
+
+static int emu_levels_show(char *buf, size_t size)
+{
+    int len = 0;
+    uint32_t i;
+
+    buf[0] = '\0';
+    for (i = 0; i < emu.nr_levels; i++)
+    {
+	len += snprintf(buf + len, size - len, "%u: threshold_mC=%d hysteresis_mC=%u alerts=%u\n",
+			i, emu.levels[i].threshold_mC, emu.levels[i].hysteresis_mC, emu.levels[i].alerts);
+    }
+
+    return len;
+}
+
+//"45000:1000 55000:1000 65000:500", same syntax and errors as levels_store()
+static int emu_levels_store(const char *buf)
+{
+    int32_t threshold[SIMTEMP_MAX_LEVELS] = { 0 };
+    uint32_t hysteresis[SIMTEMP_MAX_LEVELS] = { 0 };
+    uint32_t count = 0;
+    char copy[EMU_MAX_WRITE + 1];
+    char *cursor = copy;
+    char *token, *hyst;
+    long long value;
+    uint32_t i;
+    int ret;
+
+    snprintf(copy, sizeof(copy), "%s", buf);
+
+    while ((token = strsep(&cursor, " \t\n")) != NULL)
+    {
+	if (*token == '\0')
+	{
+	    continue;
+	}
+
+	if (count == SIMTEMP_MAX_LEVELS)
+	{
+	    return -EINVAL;    //Too many levels
+	}
+
+	hyst = strchr(token, ':');
+	if (hyst)
+	{
+	    *hyst++ = '\0';
+	    ret = emu_parse_long(hyst, 0, UINT32_MAX, &value);
+	    if (ret)
+	    {
+		return ret;
+	    }
+	    hysteresis[count] = (uint32_t)value;
+	}
+
+	ret = emu_parse_long(token, INT32_MIN, INT32_MAX, &value);
+	if (ret)
+	{
+	    return ret;
+	}
+	threshold[count++] = (int32_t)value;
+    }
+
+    for (i = 0; i < SIMTEMP_MAX_LEVELS; i++)
+    {
+	emu.levels[i].threshold_mC = threshold[i];
+	emu.levels[i].hysteresis_mC = hysteresis[i];
+    }
+    emu.nr_levels = count;
+    emu_levels_restart();
+    emu.cfg_updates++;
+    emu_notify_pollers();
+
+    return 0;
+}
+
+static int emu_clear_alert_store(const char *buf)
+{
+    uint32_t i;
+
+    (void)buf;
+
+    emu.alerts_count = 0;
+    for (i = 0; i < SIMTEMP_MAX_LEVELS; i++)
+    {
+	emu.levels[i].alerts = 0;
+    }
+    emu_notify_pollers();
+
+    return 0;
+}
+
+static int emu_always_on_show(char *buf, size_t size)
+{
+    return snprintf(buf, size, "%d\n", emu.always_on);
+}
+
+//kstrtobool(): 1/y/Y/on and 0/n/N/off
+static int emu_always_on_store(const char *buf)
+{
+    if (emu_streq(buf, "1") || emu_streq(buf, "y") || emu_streq(buf, "Y") || emu_streq(buf, "on"))
+    {
+	emu.always_on = true;
+    }
+    else if (emu_streq(buf, "0") || emu_streq(buf, "n") || emu_streq(buf, "N") || emu_streq(buf, "off"))
+    {
+	emu.always_on = false;
+    }
+    else
+    {
+	return -EINVAL;
+    }
+
+    emu_producer_update();
+
+    return 0;
+}
+
+static int emu_timer_mode_show(char *buf, size_t size)
+{
+    return snprintf(buf, size, "%s\n", emu.aligned ? "aligned" : "relative");
+}
+
+static int emu_timer_mode_store(const char *buf)
+{
+    if (emu_streq(buf, "aligned"))
+    {
+	emu.aligned = true;
+    }
+    else if (emu_streq(buf, "relative"))
+    {
+	emu.aligned = false;
+    }
+    else
+    {
+	return -EINVAL;
+    }
+
+    emu_producer_reconfigure();
+
+    return 0;
+}
+
+//cpulist format ("0-1,3"), as %*pbl
+static int emu_producer_cpus_show(char *buf, size_t size)
+{
+    int len = 0;
+    int cpu = 0;
+
+    buf[0] = '\0';
+    while (emu.pinned && cpu < CPU_SETSIZE)
+    {
+	int last = cpu;
+
+	if (!CPU_ISSET(cpu, &emu.cpus))
+	{
+	    cpu++;
+	    continue;
+	}
+	while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &emu.cpus))
+	{
+	    last++;
+	}
+
+	len += snprintf(buf + len, size - len, len ? ",%d" : "%d", cpu);
+	if (last > cpu)
+	{
+	    len += snprintf(buf + len, size - len, "-%d", last);
+	}
+	cpu = last + 1;
+    }
+    len += snprintf(buf + len, size - len, "\n");
+
+    return len;
+}
+
+//The producer is the emulator process: the list becomes its CPU affinity (empty: the affinity at start)
+static int emu_producer_cpus_store(const char *buf)
+{
+    char copy[EMU_MAX_WRITE + 1];
+    char *cursor = copy;
+    char *token;
+    cpu_set_t mask;
+
+    CPU_ZERO(&mask);
+    snprintf(copy, sizeof(copy), "%s", buf);
+    copy[strcspn(copy, "\n")] = '\0';
+
+    while ((token = strsep(&cursor, ",")) != NULL)
+    {
+	long long first, last;
+	char *dash = strchr(token, '-');
+
+	if (*token == '\0' && !cursor && !CPU_COUNT(&mask))
+	{
+	    break;     //Empty list
+	}
+	if (dash)
+	{
+	    *dash++ = '\0';
+	}
+	if (emu_parse_long(token, 0, CPU_SETSIZE - 1, &first) ||
+	    emu_parse_long(dash ? dash : token, 0, CPU_SETSIZE - 1, &last) || last < first)
+	{
+	    return -EINVAL;
+	}
+	while (first <= last)
+	{
+	    CPU_SET(first++, &mask);
+	}
+    }
+
+    if (sched_setaffinity(0, sizeof(cpu_set_t), CPU_COUNT(&mask) ? &mask : &emu.cpus_default))
+    {
+	return -EINVAL;    //No online CPU in the list
+    }
+
+    emu.cpus = mask;
+    emu.pinned = CPU_COUNT(&mask) > 0;
+
+    return 0;
+}
+
+static int emu_history_len_show(char *buf, size_t size)
+{
+    return snprintf(buf, size, "%u\n", emu.history_len);
+}
+
+//Same range and rounding as history_len_store(): up to EMU_HISTORY_MAX, rounded up to a power of two, 0 disables it
+static int emu_history_len_store(const char *buf)
+{
+    long long value;
+    int ret;
+
+    if (*buf == '-')
+    {
+	return -EINVAL;    //kstrtou32() takes no sign
+    }
+    ret = emu_parse_long(buf, 0, UINT32_MAX, &value);
+    if (ret)
+    {
+	return ret;
+    }
+    if (value > EMU_HISTORY_MAX)
+    {
+	return -EINVAL;
+    }
+
+    emu.history_len = value ? 1 : 0;
+    while (emu.history_len < value)
+    {
+	emu.history_len <<= 1;    //roundup_pow_of_two()
+    }
+
+    return 0;
+}
+
+static int emu_stats_show(char *buf, size_t size)
+{
+    return snprintf(buf, size, "updates = %u\nalerts = %u\nlast error = %d\nreaders = %u\nproducer = %s\n"
+		    "timer fires = %llu\nwakeups = %llu\njitter last ns = %llu\njitter max ns = %llu\njitter avg ns = %llu\n"
+		    "config updates = %llu\nproducer cpu = %d\noverflows = %llu\n",
+		    emu.updates_count, emu.alerts_count, 0, emu.users, emu.running ? "running" : "stopped",
+		    (unsigned long long)emu.timer_fires, (unsigned long long)emu.timer_fires,
+		    (unsigned long long)emu.jitter_last_ns, (unsigned long long)emu.jitter_max_ns,
+		    (unsigned long long)(emu.timer_fires ? emu.jitter_sum_ns / emu.timer_fires : 0),
+		    (unsigned long long)emu.cfg_updates, emu.producer_cpu, (unsigned long long)emu.overflows);
+}
+
+//Binary attribute 'stats_bin': struct simtemp_stats, as the driver fills it in simtemp_stats_snapshot()
+static int emu_stats_bin_show(char *buf, size_t size)
+{
+    struct simtemp_stats st;
+    uint32_t i;
+
+    memset(&st, 0, sizeof(st));
+    st.size = sizeof(st);
+    st.updates = emu.updates_count;
+    st.overflows = emu.overflows;
+    st.timer_fires = emu.timer_fires;
+    st.wakeups = emu.timer_fires;
+    st.jitter_last_ns = emu.jitter_last_ns;
+    st.jitter_max_ns = emu.jitter_max_ns;
+    st.jitter_sum_ns = emu.jitter_sum_ns;
+    st.config_updates = emu.cfg_updates;
+    st.alerts = emu.alerts_count;
+    st.readers = emu.users;
+    st.running = emu.running;
+    st.producer_cpu = emu.producer_cpu;
+    st.sampling_ms = emu.sampling_ms;
+    st.threshold_mC = emu.levels[0].threshold_mC;
+    st.queued = emu.count;
+    st.nr_levels = emu.nr_levels;
+    for (i = 0; i < SIMTEMP_MAX_LEVELS; i++)
+    {
+	st.level_alerts[i] = emu.levels[i].alerts;
+	st.level_alerts_total[i] = emu.levels[i].alerts_total;
+    }
+
+    memcpy(buf, &st, size < sizeof(st) ? size : sizeof(st));
+
+    return sizeof(st);
+}
+
+static const struct emu_attr emu_attrs[] = {
+    { "sampling_ms",    0644, emu_sampling_ms_show,     emu_sampling_ms_store },
+    { "rate_hz",        0644, emu_rate_hz_show,         emu_rate_hz_store },
+    { "threshold_mC",   0644, emu_threshold_mC_show,    emu_threshold_mC_store },
+    { "levels",         0644, emu_levels_show,          emu_levels_store },
+    { "stats",          0444, emu_stats_show,           NULL },
+    { "stats_bin",      0444, emu_stats_bin_show,       NULL },
+    { "clear_alert",    0200, NULL,                     emu_clear_alert_store },
+    { "always_on",      0644, emu_always_on_show,       emu_always_on_store },
+    { "timer_mode",     0644, emu_timer_mode_show,      emu_timer_mode_store },
+    { "producer_cpus",  0644, emu_producer_cpus_show,   emu_producer_cpus_store },
+    { "history_len",    0644, emu_history_len_show,     emu_history_len_store },
+};
+
+#define EMU_NR_ATTRS    (sizeof(emu_attrs) / sizeof(emu_attrs[0]))
+
+static const struct emu_attr *emu_attr_of(uint64_t ino)
+{
+    return (ino >= EMU_INO_ATTR0 && ino < EMU_INO_ATTR0 + EMU_NR_ATTRS) ? &emu_attrs[ino - EMU_INO_ATTR0] : NULL;
+}
+
+
+// ---------------------- (FUSE File System: lookup, attributes, directories)  ---------------------------------
+static bool emu_fill_attr(uint64_t ino, struct fuse_attr *attr)
+{
+    const struct emu_attr *a = emu_attr_of(ino);
+
+    memset(attr, 0, sizeof(*attr));
+    attr->ino = ino;
+    attr->atime = attr->mtime = attr->ctime = emu.start_time;
+    attr->uid = getuid();
+    attr->gid = getgid();
+    attr->blksize = 4096;
+    attr->nlink = 1;
+
+    if (ino == EMU_INO_ROOT || ino == EMU_INO_SYSFS)
+    {
+	attr->mode = S_IFDIR | 0755;
+	attr->nlink = 2;
+    }
+    else if (ino == EMU_INO_DATA)
+    {
+	attr->mode = S_IFREG | 0666;   //As /dev/simtemp after run_demo.sh
+    }
+    else if (a)
+    {
+	attr->mode = S_IFREG | a->mode;
+	attr->size = (a->show == emu_stats_bin_show) ? sizeof(struct simtemp_stats) : EMU_ATTR_SIZE;  //Binary attributes have their real size
+    }
+    else
+    {
+	return false;
+    }
+
+    return true;
+}
+
+static void emu_lookup(int fd, uint64_t unique, uint64_t parent, const char *name)
+{
+    struct fuse_entry_out out = { 0 };
+    uint64_t ino = 0;
+    uint32_t i;
+
+    if (parent == EMU_INO_ROOT)
+    {
+	if (!strcmp(name, "simtemp"))
+	{
+	    ino = EMU_INO_DATA;
+	}
+	else if (!strcmp(name, "sysfs"))
+	{
+	    ino = EMU_INO_SYSFS;
+	}
+    }
+    else if (parent == EMU_INO_SYSFS)
+    {
+	for (i = 0; i < EMU_NR_ATTRS; i++)
+	{
+	    if (!strcmp(name, emu_attrs[i].name))
+	    {
+		ino = EMU_INO_ATTR0 + i;
+	    }
+	}
+    }
+
+    if (!ino)
+    {
+	emu_reply(fd, unique, -ENOENT, NULL, 0);
+	return;
+    }
+
+    out.nodeid = ino;
+    out.generation = 1;
+    out.entry_valid = 3600;    //The tree never changes
+    emu_fill_attr(ino, &out.attr);
+    emu_reply(fd, unique, 0, &out, sizeof(out));
+}
+
+static void emu_getattr(int fd, uint64_t unique, uint64_t ino)
+{
+    struct fuse_attr_out out = { 0 };
+
+    if (!emu_fill_attr(ino, &out.attr))
+    {
+	emu_reply(fd, unique, -ENOENT, NULL, 0);
+	return;
+    }
+    emu_reply(fd, unique, 0, &out, sizeof(out));
+}
+
+//Directory listing: entry 'offset' onwards while they fit in 'size'
+static void emu_readdir(int fd, uint64_t unique, uint64_t ino, const struct fuse_read_in *arg)
+{
+    static const char *const root[] = { ".", "..", "simtemp", "sysfs" };
+    char buf[4096];
+    size_t len = 0;
+    uint64_t i, nr;
+
+    nr = (ino == EMU_INO_ROOT) ? 4 : 2 + EMU_NR_ATTRS;
+
+    for (i = arg->offset; i < nr; i++)
+    {
+	const char *name;
+	struct fuse_dirent *de = (struct fuse_dirent *)(buf + len);
+	uint64_t entry_ino;
+	size_t reclen;
+
+	if (ino == EMU_INO_ROOT)
+	{
+	    name = root[i];
+	    entry_ino = (i < 2) ? EMU_INO_ROOT : (i == 2 ? EMU_INO_DATA : EMU_INO_SYSFS);
+	}
+	else
+	{
+	    name = (i == 0) ? "." : (i == 1) ? ".." : emu_attrs[i - 2].name;
+	    entry_ino = (i == 0) ? EMU_INO_SYSFS : (i == 1) ? EMU_INO_ROOT : EMU_INO_ATTR0 + i - 2;
+	}
+
+	reclen = FUSE_DIRENT_ALIGN(FUSE_NAME_OFFSET + strlen(name));
+	if (len + reclen > arg->size || len + reclen > sizeof(buf))
+	{
+	    break;
+	}
+
+	memset(de, 0, reclen);
+	de->ino = entry_ino;
+	de->off = i + 1;
+	de->namelen = strlen(name);
+	de->type = (entry_ino == EMU_INO_ROOT || entry_ino == EMU_INO_SYSFS) ? DT_DIR : DT_REG;
+	memcpy(de->name, name, de->namelen);
+	len += reclen;
+    }
+
+    emu_reply(fd, unique, 0, buf, len);
+}
+
+
+// ---------------------- (Request Dispatcher)  ---------------------------------------
+static void emu_open(int fd, uint64_t unique, uint64_t ino, bool cuse)
+{
+    struct fuse_open_out out = { .open_flags = FOPEN_DIRECT_IO };
+    uint32_t i;
+
+    if (cuse || ino == EMU_INO_DATA)
+    {
+	for (i = 0; i < EMU_MAX_FILES && emu.files[i].used; i++)
+	{
+	}
+	if (i == EMU_MAX_FILES)
+	{
+	    emu_reply(fd, unique, -EMFILE, NULL, 0);
+	    return;
+	}
+
+	emu.files[i] = (struct emu_file){ .used = true, .fd = fd };
+	emu.users++;
+	emu_producer_update();     //Lazy Producer: the first open starts it
+
+	out.fh = i;
+	out.open_flags |= FOPEN_NONSEEKABLE;
+#ifdef FOPEN_STREAM
+	out.open_flags |= FOPEN_STREAM;
+#endif
+    }
+    else if (!emu_attr_of(ino) && ino != EMU_INO_ROOT && ino != EMU_INO_SYSFS)
+    {
+	emu_reply(fd, unique, -ENOENT, NULL, 0);
+	return;
+    }
+
+    emu_reply(fd, unique, 0, &out, sizeof(out));
+}
+
+static void emu_release(int fd, uint64_t unique, uint64_t ino, uint64_t fh, bool cuse)
+{
+    if ((cuse || ino == EMU_INO_DATA) && fh < EMU_MAX_FILES && emu.files[fh].used)
+    {
+	emu.files[fh].used = false;
+	emu.users--;
+	emu_producer_update();     //The last close stops it
+    }
+
+    emu_reply(fd, unique, 0, NULL, 0);
+}
+
+static void emu_attr_read(int fd, uint64_t unique, const struct emu_attr *a, const struct fuse_read_in *arg)
+{
+    char buf[EMU_ATTR_SIZE];
+    int len;
+
+    if (!a->show)
+    {
+	emu_reply(fd, unique, -EIO, NULL, 0);
+	return;
+    }
+
+    len = a->show(buf, sizeof(buf));
+    if (len > (int)sizeof(buf) - 1)
+    {
+	len = sizeof(buf) - 1;
+    }
+    if (arg->offset >= (uint64_t)len)
+    {
+	emu_reply(fd, unique, 0, NULL, 0);
+	return;
+    }
+
+    len -= arg->offset;
+    emu_reply(fd, unique, 0, buf + arg->offset, (uint32_t)len < arg->size ? (uint32_t)len : arg->size);
+}
+
+static void emu_attr_write(int fd, uint64_t unique, const struct emu_attr *a, const struct fuse_write_in *arg, const char *data)
+{
+    struct fuse_write_out out = { .size = arg->size };
+    char buf[EMU_MAX_WRITE + 1];
+    int ret;
+
+    if (!a->store)
+    {
+	emu_reply(fd, unique, -EIO, NULL, 0);
+	return;
+    }
+    if (arg->size > EMU_MAX_WRITE)
+    {
+	emu_reply(fd, unique, -EINVAL, NULL, 0);
+	return;
+    }
+
+    memcpy(buf, data, arg->size);
+    buf[arg->size] = '\0';
+
+    ret = a->store(buf);
+    emu_reply(fd, unique, ret, &out, sizeof(out));
+}
+
+static void emu_init(int fd, uint64_t unique, const struct fuse_init_in *arg)
+{
+    struct fuse_init_out out = { 0 };
+
+    out.major = FUSE_KERNEL_VERSION;
+    out.minor = arg->minor < FUSE_KERNEL_MINOR_VERSION ? arg->minor : FUSE_KERNEL_MINOR_VERSION;
+    out.max_readahead = arg->max_readahead;
+    out.flags = FUSE_ATOMIC_O_TRUNC & arg->flags;  //open(O_TRUNC) of an attribute without a SETATTR request
+    out.max_background = 16;
+    out.congestion_threshold = 12;
+    out.max_write = EMU_MAX_WRITE;
+    out.time_gran = 1;
+
+    emu_reply(fd, unique, 0, &out, out.minor < 23 ? FUSE_COMPAT_22_INIT_OUT_SIZE : sizeof(out));
+}
+
+//One request of /dev/fuse or /dev/cuse. Returns false when the session ends.
+static bool emu_dispatch(int fd, bool cuse, const char *req, size_t len)
+{
+    const struct fuse_in_header *in = (const struct fuse_in_header *)req;
+    const void *arg = req + sizeof(*in);
+    const struct emu_attr *a = cuse ? NULL : emu_attr_of(in->nodeid);
+    bool data = cuse || in->nodeid == EMU_INO_DATA;
+
+    if (len < sizeof(*in))
+    {
+	return true;
+    }
+
+    switch (in->opcode)
+    {
+    case FUSE_INIT:
+	emu_init(fd, in->unique, arg);
+	break;
+    case FUSE_DESTROY:
+	emu_reply(fd, in->unique, 0, NULL, 0);
+	return false;
+    case FUSE_LOOKUP:
+	emu_lookup(fd, in->unique, in->nodeid, arg);
+	break;
+    case FUSE_FORGET:
+    case FUSE_BATCH_FORGET:
+	break;             //No reply
+    case FUSE_GETATTR:
+    case FUSE_SETATTR:
+	emu_getattr(fd, in->unique, in->nodeid);   //Sizes and modes are fixed: a truncate of an attribute is ignored
+	break;
+    case FUSE_OPENDIR:
+	emu_reply(fd, in->unique, 0, &(struct fuse_open_out){ 0 }, sizeof(struct fuse_open_out));
+	break;
+    case FUSE_READDIR:
+	emu_readdir(fd, in->unique, in->nodeid, arg);
+	break;
+    case FUSE_OPEN:
+	emu_open(fd, in->unique, in->nodeid, cuse);
+	break;
+    case FUSE_READ:
+	if (data)
+	{
+	    emu_data_read(fd, in->unique, arg);
+	}
+	else if (a)
+	{
+	    emu_attr_read(fd, in->unique, a, arg);
+	}
+	else
+	{
+	    emu_reply(fd, in->unique, -EISDIR, NULL, 0);
+	}
+	break;
+    case FUSE_WRITE:
+	if (a)
+	{
+	    emu_attr_write(fd, in->unique, a, arg, (const char *)arg + sizeof(struct fuse_write_in));
+	}
+	else
+	{
+	    emu_reply(fd, in->unique, -EINVAL, NULL, 0);   //The driver has no write()
+	}
+	break;
+    case FUSE_POLL:
+	if (data)
+	{
+	    emu_data_poll(fd, in->unique, arg);
+	}
+	else
+	{
+	    struct fuse_poll_out out = { .revents = POLLIN | POLLRDNORM | POLLOUT };
+
+	    emu_reply(fd, in->unique, 0, &out, sizeof(out));
+	}
+	break;
+    case FUSE_INTERRUPT:
+	emu_interrupt(((const struct fuse_interrupt_in *)arg)->unique);
+	break;
+    case FUSE_FLUSH:
+    case FUSE_RELEASEDIR:
+    case FUSE_FSYNC:
+	emu_reply(fd, in->unique, 0, NULL, 0);
+	break;
+    case FUSE_RELEASE:
+	emu_release(fd, in->unique, in->nodeid, ((const struct fuse_release_in *)arg)->fh, cuse);
+	break;
+    case FUSE_IOCTL:
+	emu_reply(fd, in->unique, -ENOTTY, NULL, 0);   //Per-file filters, delivery modes and GET_HISTORY are not emulated
+	break;
+    case FUSE_STATFS:
+	emu_reply(fd, in->unique, 0, &(struct fuse_statfs_out){ .st = { .bsize = 4096, .namelen = 255, .frsize = 4096 } },
+		  sizeof(struct fuse_statfs_out));
+	break;
+    default:
+	emu_reply(fd, in->unique, -ENOSYS, NULL, 0);
+	break;
+    }
+
+    return true;
+}
+
+
+// ---------------------- (Sessions: FUSE mount and CUSE device)  ---------------------------------------
+static int emu_mount(const char *mountpoint)
+{
+    char opts[256];
+    int fd;
+
+    fd = open("/dev/fuse", O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+    {
+	perror("simtemp_emu: /dev/fuse");
+	return -1;
+    }
+
+    snprintf(opts, sizeof(opts), "fd=%d,rootmode=40000,user_id=%u,group_id=%u,default_permissions%s",
+	     fd, getuid(), getgid(), getuid() == 0 ? ",allow_other" : "");
+
+    if (mount("simtemp_emu", mountpoint, "fuse.simtemp_emu", MS_NOSUID | MS_NODEV, opts))
+    {
+	perror("simtemp_emu: mount (root or CAP_SYS_ADMIN and /dev/fuse are needed)");
+	close(fd);
+	return -1;
+    }
+
+    return fd;
+}
+
+//Registers /dev/<name>: CUSE_INIT is answered before the device node exists
+static int emu_cuse_open(const char *name)
+{
+    static char req[EMU_REQ_BUFFER];
+    struct
+    {
+	struct cuse_init_out init;
+	char info[128];
+    } out;
+    const struct fuse_in_header *in = (const struct fuse_in_header *)req;
+    const struct cuse_init_in *arg = (const struct cuse_init_in *)(req + sizeof(*in));
+    ssize_t len;
+    int info_len;
+    int fd;
+
+    fd = open("/dev/cuse", O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+    {
+	perror("simtemp_emu: /dev/cuse");
+	return -1;
+    }
+
+    len = read(fd, req, sizeof(req));
+    if (len < (ssize_t)(sizeof(*in) + sizeof(*arg)) || in->opcode != CUSE_INIT)
+    {
+	fprintf(stderr, "simtemp_emu: unexpected CUSE handshake\n");
+	close(fd);
+	return -1;
+    }
+
+    memset(&out, 0, sizeof(out));
+    out.init.major = FUSE_KERNEL_VERSION;
+    out.init.minor = arg->minor < FUSE_KERNEL_MINOR_VERSION ? arg->minor : FUSE_KERNEL_MINOR_VERSION;
+    out.init.max_read = EMU_MAX_READ;
+    out.init.max_write = EMU_MAX_WRITE;
+    info_len = snprintf(out.info, sizeof(out.info), "DEVNAME=%s", name) + 1;
+
+    emu_reply(fd, in->unique, 0, &out, sizeof(out.init) + info_len);
+
+    return fd;
+}
+
+//Every queued request of one session (non-blocking fd). Returns false when the session ended.
+static bool emu_session_drain(int fd, bool cuse)
+{
+    static char req[EMU_REQ_BUFFER];
+    ssize_t len;
+
+    for (;;)
+    {
+	len = read(fd, req, sizeof(req));
+	if (len < 0)
+	{
+	    if (errno == EAGAIN || errno == EINTR)
+	    {
+		return true;
+	    }
+	    if (errno == ENOENT)
+	    {
+		continue;      //Request interrupted before it was read
+	    }
+	    return false;      //ENODEV: unmounted or device removed
+	}
+
+	if (!emu_dispatch(fd, cuse, req, len))
+	{
+	    return false;
+	}
+    }
+}
+
+
+// ---------------------- (Main)  ---------------------------------------
+static void emu_usage(const char *prog)
+{
+    fprintf(stderr,
+	    "Usage: %s -m MOUNTPOINT [options]\n"
+	    "  -m  mount point of the data file (simtemp) and of the controls (sysfs/)\n"
+	    "  -c  also register /dev/NAME through CUSE (needs /dev/cuse)\n"
+	    "  -r  rate in Hz, 1..%d (default 10, sampling_ms = 100)\n"
+	    "  -t  threshold_mC of level 0 (default 4500, as the driver without DT)\n"
+	    "  -l  threshold table, e.g. \"45000:1000 55000:1000\"\n"
+	    "  -b  ring size in samples (default %d, as the driver)\n"
+	    "  -a  always on: produce samples without readers\n"
+	    "  -s  seed of the temperature generator (default: time)\n",
+	    prog, EMU_MAX_RATE_HZ, EMU_RING_DEFAULT);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *mountpoint = NULL;
+    const char *cuse_name = NULL;
+    const char *levels = NULL;
+    long long rate = 10;
+    long long threshold = 4500;
+    long long ring = EMU_RING_DEFAULT;
+    long long seed = 0;
+    struct epoll_event ev;
+    char rate_buf[32];
+    sigset_t sigs;
+    int sfd, efd;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "m:c:r:t:l:b:as:h")) != -1)
+    {
+	switch (opt)
+	{
+	case 'm':
+	    mountpoint = optarg;
+	    break;
+	case 'c':
+	    cuse_name = optarg;
+	    break;
+	case 'r':
+	    if (emu_parse_long(optarg, 1, EMU_MAX_RATE_HZ, &rate))
+	    {
+		emu_usage(argv[0]);
+		return 2;
+	    }
+	    break;
+	case 't':
+	    if (emu_parse_long(optarg, INT32_MIN, INT32_MAX, &threshold))
+	    {
+		emu_usage(argv[0]);
+		return 2;
+	    }
+	    break;
+	case 'l':
+	    levels = optarg;
+	    break;
+	case 'b':
+	    if (emu_parse_long(optarg, 1, 1 << 20, &ring))
+	    {
+		emu_usage(argv[0]);
+		return 2;
+	    }
+	    break;
+	case 'a':
+	    emu.always_on = true;
+	    break;
+	case 's':
+	    if (emu_parse_long(optarg, 1, UINT32_MAX, &seed))
+	    {
+		emu_usage(argv[0]);
+		return 2;
+	    }
+	    break;
+	default:
+	    emu_usage(argv[0]);
+	    return opt == 'h' ? 0 : 2;
+	}
+    }
+
+    if (!mountpoint)
+    {
+	emu_usage(argv[0]);
+	return 2;
+    }
+
+    //Initial state, as probe() without DT
+    emu.ring_size = (uint32_t)ring;
+    emu.ring = calloc(emu.ring_size, sizeof(*emu.ring));
+    emu.nr_levels = 1;
+    emu.levels[0].threshold_mC = (int32_t)threshold;
+    emu.history_len = EMU_HISTORY_DEFAULT;
+    emu.producer_cpu = -1;
+    emu.rng = seed ? (uint32_t)seed : (uint32_t)emu_clock_ns(CLOCK_REALTIME) | 1;
+    emu.start_time = time(NULL);
+    emu.cuse_fd = -1;
+    sched_getaffinity(0, sizeof(cpu_set_t), &emu.cpus_default);
+
+    snprintf(rate_buf, sizeof(rate_buf), "%lld", rate);
+    emu_rate_hz_store(rate_buf);
+    if (levels && emu_levels_store(levels))
+    {
+	fprintf(stderr, "simtemp_emu: invalid threshold table \"%s\"\n", levels);
+	return 2;
+    }
+    emu.cfg_updates = 0;
+
+    emu.tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (!emu.ring || emu.tfd < 0)
+    {
+	perror("simtemp_emu");
+	return 1;
+    }
+
+    //SIGINT/SIGTERM end the loop and unmount
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGINT);
+    sigaddset(&sigs, SIGTERM);
+    sigprocmask(SIG_BLOCK, &sigs, NULL);
+    sfd = signalfd(-1, &sigs, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    emu.fuse_fd = emu_mount(mountpoint);
+    if (emu.fuse_fd < 0)
+    {
+	return 1;
+    }
+    if (cuse_name)
+    {
+	emu.cuse_fd = emu_cuse_open(cuse_name);
+	if (emu.cuse_fd < 0)
+	{
+	    umount2(mountpoint, MNT_DETACH);
+	    return 1;
+	}
+    }
+
+    efd = epoll_create1(EPOLL_CLOEXEC);
+    ev.events = EPOLLIN;
+    ev.data.fd = emu.fuse_fd;
+    epoll_ctl(efd, EPOLL_CTL_ADD, emu.fuse_fd, &ev);
+    ev.data.fd = emu.tfd;
+    epoll_ctl(efd, EPOLL_CTL_ADD, emu.tfd, &ev);
+    ev.data.fd = sfd;
+    epoll_ctl(efd, EPOLL_CTL_ADD, sfd, &ev);
+    fcntl(emu.fuse_fd, F_SETFL, O_NONBLOCK);
+    if (emu.cuse_fd >= 0)
+    {
+	ev.data.fd = emu.cuse_fd;
+	epoll_ctl(efd, EPOLL_CTL_ADD, emu.cuse_fd, &ev);
+	fcntl(emu.cuse_fd, F_SETFL, O_NONBLOCK);
+    }
+
+    emu_producer_update();     //always_on
+    printf("simtemp_emu: %s/simtemp and %s/sysfs ready%s%s (rate %lld Hz, ring %u)\n",
+	   mountpoint, mountpoint, cuse_name ? ", /dev/" : "", cuse_name ? cuse_name : "", rate, emu.ring_size);
+    fflush(stdout);
+
+    for (;;)
+    {
+	struct epoll_event events[4];
+	int n, i;
+	bool done = false;
+
+	n = epoll_wait(efd, events, 4, -1);
+	if (n < 0 && errno != EINTR)
+	{
+	    perror("simtemp_emu: epoll_wait");
+	    break;
+	}
+
+	for (i = 0; i < n; i++)
+	{
+	    int fd = events[i].data.fd;
+
+	    if (fd == emu.tfd)
+	    {
+		emu_producer_fire();
+	    }
+	    else if (fd == sfd)
+	    {
+		done = true;
+	    }
+	    else if (!emu_session_drain(fd, fd == emu.cuse_fd))
+	    {
+		done = true;
+	    }
+	}
+
+	if (done)
+	{
+	    break;
+	}
+    }
+
+    umount2(mountpoint, MNT_DETACH);
+    printf("simtemp_emu: %u samples produced, %llu overwritten\n", emu.updates_count, (unsigned long long)emu.overflows);
+
+    return 0;
+}
@@ -0,0 +1,656 @@
+/***************************************************************************
+	Open Source License 2025 NXP Semiconductor Challenge Stage
+****************************************************************************
+* Title        : simtemp_exporter.cpp
+* Description  : OpenMetrics exporter of the statistics of every simtemp instance
+*
+* Environment  : C++17 (User Space)
+*
+* Responsible  : Daniel R Miranda [danielrmirandacortes@gmail.com]
+*
+* Guidelines   : Linux Kernel Coding Style
+*
+*
+* The instances are discovered in the sysfs directory of the platform driver and their
+* attributes are opened once. A scrape is one pread() of 'stats_bin' (struct simtemp_stats)
+* per instance: no open()/close(), no path lookup and no text parsing. Instances without
+* 'stats_bin' (older drivers) fall back to pread() of the text attributes kept open.
+* The driver's data device is never opened, so the exporter does not count as a reader and
+* does not start a lazy producer.
+*
+*   simtemp_exporter                                   //HTTP on 127.0.0.1:9475, GET /metrics
+*   simtemp_exporter -u /run/simtemp_exporter.sock     //HTTP on a Unix socket
+*   simtemp_exporter -o                                //one scrape to stdout
+*   simtemp_exporter -B 100000                         //cost of one collection pass
+*
+****************************************************************************
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* * * * * * * * * * * Header Files *   *   *   *   *   *   *   *   *   *   *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <csignal>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../../kernel/nxp_simtemp_ioctl.h"    //User/Kernel Contract: struct simtemp_stats
+
+namespace
+{
+
+constexpr const char *DRIVER_DIR = "/sys/bus/platform/drivers/nxp_simtemp";
+constexpr uint16_t DEFAULT_PORT = 9475;
+constexpr int RESCAN_S = 10;                //Instances are discovered again every RESCAN_S seconds
+
+//One driver instance: its sysfs directory and the attributes kept open
+struct Instance
+{
+    std::string     dir;
+    std::string     name;           //Label 'device': directory name (nxp_simtemp, nxp_simtemp.1, ...)
+    int             bin_fd = -1;    //stats_bin
+    int             stats_fd = -1;  //Fallback: stats, sampling_ms, threshold_mC (text)
+    int             sampling_fd = -1;
+    int             threshold_fd = -1;
+    bool            up = false;     //Last collection succeeded
+    struct simtemp_stats st = {};
+};
+
+volatile sig_atomic_t stop_requested;
+
+void on_signal(int)
+{
+    stop_requested = 1;
+}
+
+uint64_t now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void close_fd(int &fd)
+{
+    if (fd >= 0)
+    {
+	::close(fd);
+	fd = -1;
+    }
+}
+
+//----------------- Instances: discovery and collection  --------------------//
+int open_attr(const std::string &dir, const char *attr)
+{
+    return open((dir + "/" + attr).c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+void instance_open(Instance &in)
+{
+    in.bin_fd = open_attr(in.dir, "stats_bin");
+    if (in.bin_fd < 0)
+    {
+	in.stats_fd = open_attr(in.dir, "stats");
+	in.sampling_fd = open_attr(in.dir, "sampling_ms");
+	in.threshold_fd = open_attr(in.dir, "threshold_mC");
+    }
+}
+
+void instance_close(Instance &in)
+{
+    close_fd(in.bin_fd);
+    close_fd(in.stats_fd);
+    close_fd(in.sampling_fd);
+    close_fd(in.threshold_fd);
+}
+
+//Text attribute kept open: pread() at offset 0 makes sysfs generate it again
+ssize_t read_text(int fd, char *buf, size_t size)
+{
+    ssize_t n = pread(fd, buf, size - 1, 0);
+
+    buf[n > 0 ? n : 0] = '\0';
+
+    return n;
+}
+
+//Fallback for drivers without stats_bin: "name = value" lines of 'stats'
+bool collect_text(Instance &in)
+{
+    static const struct
+    {
+	const char *key;
+	size_t      offset;
+	bool        wide;
+    } keys[] = {
+	{ "updates",        offsetof(struct simtemp_stats, updates),        true },
+	{ "overflows",      offsetof(struct simtemp_stats, overflows),      true },
+	{ "timer fires",    offsetof(struct simtemp_stats, timer_fires),    true },
+	{ "wakeups",        offsetof(struct simtemp_stats, wakeups),        true },
+	{ "jitter last ns", offsetof(struct simtemp_stats, jitter_last_ns), true },
+	{ "jitter max ns",  offsetof(struct simtemp_stats, jitter_max_ns),  true },
+	{ "config updates", offsetof(struct simtemp_stats, config_updates), true },
+	{ "alerts",         offsetof(struct simtemp_stats, alerts),         false },
+	{ "readers",        offsetof(struct simtemp_stats, readers),        false },
+    };
+    char buf[1024];
+    char *line, *eq;
+
+    if (in.stats_fd < 0 || read_text(in.stats_fd, buf, sizeof(buf)) <= 0)
+    {
+	return false;
+    }
+
+    memset(&in.st, 0, sizeof(in.st));
+    in.st.producer_cpu = -1;
+
+    for (line = strtok(buf, "\n"); line; line = strtok(nullptr, "\n"))
+    {
+	eq = strstr(line, " = ");
+	if (!eq)
+	{
+	    continue;
+	}
+	*eq = '\0';
+	eq += 3;
+
+	for (const auto &k : keys)
+	{
+	    if (!strcmp(line, k.key))
+	    {
+		unsigned long long v = strtoull(eq, nullptr, 10);
+		char *field = reinterpret_cast<char *>(&in.st) + k.offset;
+
+		if (k.wide)
+		{
+		    memcpy(field, &v, sizeof(uint64_t));
+		}
+		else
+		{
+		    uint32_t v32 = (uint32_t)v;
+
+		    memcpy(field, &v32, sizeof(v32));
+		}
+	    }
+	}
+	if (!strcmp(line, "producer"))
+	{
+	    in.st.running = !strcmp(eq, "running");
+	}
+	else if (!strcmp(line, "producer cpu"))
+	{
+	    in.st.producer_cpu = atoi(eq);
+	}
+	else if (!strcmp(line, "jitter avg ns"))
+	{
+	    in.st.jitter_sum_ns = strtoull(eq, nullptr, 10) * in.st.timer_fires;
+	}
+    }
+
+    if (in.sampling_fd >= 0 && read_text(in.sampling_fd, buf, sizeof(buf)) > 0)
+    {
+	in.st.sampling_ms = atoi(buf);
+    }
+    if (in.threshold_fd >= 0 && read_text(in.threshold_fd, buf, sizeof(buf)) > 0)
+    {
+	in.st.threshold_mC = atoi(buf);
+	in.st.nr_levels = 1;
+    }
+
+    return true;
+}
+
+bool collect(Instance &in)
+{
+    ssize_t n;
+
+    if (in.bin_fd < 0)
+    {
+	return collect_text(in);
+    }
+
+    //Fields appended by a newer driver are ignored, fields missing in an older one stay 0
+    n = pread(in.bin_fd, &in.st, sizeof(in.st), 0);
+    if (n < (ssize_t)offsetof(struct simtemp_stats, overflows))
+    {
+	return false;
+    }
+    if ((size_t)n < sizeof(in.st))
+    {
+	memset(reinterpret_cast<char *>(&in.st) + n, 0, sizeof(in.st) - n);
+    }
+
+    return true;
+}
+
+//Instances present in the driver directory (or the directories given with -s). Open instances are kept.
+void discover(std::vector<Instance> &instances, const std::vector<std::string> &dirs)
+{
+    std::vector<std::string> found = dirs;
+    std::vector<Instance> next;
+    struct dirent *de;
+    DIR *d;
+
+    if (dirs.empty())
+    {
+	d = opendir(DRIVER_DIR);
+	while (d && (de = readdir(d)))
+	{
+	    std::string dir = std::string(DRIVER_DIR) + "/" + de->d_name;
+	    struct stat sb;
+
+	    //Bound devices are links with their attributes; module, bind, uevent... are not
+	    if (de->d_name[0] != '.' && !stat((dir + "/stats").c_str(), &sb))
+	    {
+		found.push_back(dir);
+	    }
+	}
+	if (d)
+	{
+	    closedir(d);
+	}
+	std::sort(found.begin(), found.end());
+    }
+
+    for (const std::string &dir : found)
+    {
+	auto it = std::find_if(instances.begin(), instances.end(), [&](const Instance &in) { return in.dir == dir; });
+
+	if (it != instances.end() && it->up)
+	{
+	    next.push_back(*it);
+	    it->bin_fd = it->stats_fd = it->sampling_fd = it->threshold_fd = -1;    //Moved to 'next'
+	    continue;
+	}
+
+	Instance in;
+
+	in.dir = dir;
+	in.name = dir.substr(dir.find_last_of('/') + 1);
+	instance_open(in);
+	in.up = in.bin_fd >= 0 || in.stats_fd >= 0;
+	next.push_back(in);
+    }
+
+    for (Instance &in : instances)
+    {
+	instance_close(in);
+    }
+    instances.swap(next);
+}
+
+//----------------- OpenMetrics text  --------------------//
+void append(std::string &out, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+void append(std::string &out, const char *fmt, ...)
+{
+    char buf[256];
+    va_list ap;
+    int n;
+
+    va_start(ap, fmt);
+    n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+
+    out.append(buf, std::min<size_t>(n, sizeof(buf) - 1));
+}
+
+//One metric family: header and one line per instance that is up
+template <typename F>
+void family(std::string &out, const std::vector<Instance> &instances, const char *name, const char *type,
+	    const char *help, F value)
+{
+    append(out, "# TYPE %s %s\n# HELP %s %s\n", name, type, name, help);
+
+    for (const Instance &in : instances)
+    {
+	if (in.up)
+	{
+	    append(out, "%s%s{device=\"%s\"} ", name, strcmp(type, "counter") ? "" : "_total", in.name.c_str());
+	    value(out, in.st);
+	    out += '\n';
+	}
+    }
+}
+
+#define U64(field)  [](std::string &o, const struct simtemp_stats &s) { append(o, "%llu", (unsigned long long)s.field); }
+#define SEC(expr)   [](std::string &o, const struct simtemp_stats &s) { append(o, "%.9f", (double)(expr) / 1e9); }
+
+void format(std::string &out, const std::vector<Instance> &instances, uint64_t collect_ns)
+{
+    out.clear();
+
+    append(out, "# TYPE simtemp_up gauge\n# HELP simtemp_up 1 if the statistics of the instance could be read.\n");
+    for (const Instance &in : instances)
+    {
+	append(out, "simtemp_up{device=\"%s\"} %d\n", in.name.c_str(), in.up);
+    }
+
+    family(out, instances, "simtemp_samples", "counter", "Samples produced.", U64(updates));
+    family(out, instances, "simtemp_overflows", "counter", "Samples overwritten before the shared queue consumed them.", U64(overflows));
+    family(out, instances, "simtemp_timer_fires", "counter", "Callbacks of the producer.", U64(timer_fires));
+    family(out, instances, "simtemp_timer_wakeups", "counter", "Callbacks not coalesced with another producer.", U64(wakeups));
+    family(out, instances, "simtemp_config_updates", "counter", "Configuration snapshots published.", U64(config_updates));
+    family(out, instances, "simtemp_timer_jitter_seconds", "counter", "Sum of the delays of the callbacks.", SEC(s.jitter_sum_ns));
+    family(out, instances, "simtemp_timer_jitter_last_seconds", "gauge", "Delay of the last callback.", SEC(s.jitter_last_ns));
+    family(out, instances, "simtemp_timer_jitter_max_seconds", "gauge", "Worst delay of a callback.", SEC(s.jitter_max_ns));
+    family(out, instances, "simtemp_alerts_pending", "gauge", "Alerts not acknowledged yet.", U64(alerts));
+    family(out, instances, "simtemp_readers", "gauge", "Open files of the device.", U64(readers));
+    family(out, instances, "simtemp_queued_samples", "gauge", "Samples waiting in the shared queue.", U64(queued));
+    family(out, instances, "simtemp_producer_running", "gauge", "1 while the producer runs.", U64(running));
+    family(out, instances, "simtemp_producer_cpu", "gauge", "CPU of the last callback (-1: none yet).",
+	   [](std::string &o, const struct simtemp_stats &s) { append(o, "%d", s.producer_cpu); });
+    family(out, instances, "simtemp_sampling_period_seconds", "gauge", "Sampling period.", SEC(s.sampling_ms * 1000000LL));
+    family(out, instances, "simtemp_threshold_celsius", "gauge", "Threshold of level 0.",
+	   [](std::string &o, const struct simtemp_stats &s) { append(o, "%.3f", s.threshold_mC / 1000.0); });
+
+    //Per-level families: 'level_alerts' goes down when read() acknowledges an alert, so it is a gauge;
+    //'level_alerts_total' only grows and exists from the driver that appended it to struct simtemp_stats
+    append(out, "# TYPE simtemp_level_alerts_pending gauge\n# HELP simtemp_level_alerts_pending Alerts not acknowledged yet of each threshold level.\n");
+    for (const Instance &in : instances)
+    {
+	for (uint32_t i = 0; in.up && i < in.st.nr_levels && i < SIMTEMP_MAX_LEVELS; i++)
+	{
+	    append(out, "simtemp_level_alerts_pending{device=\"%s\",level=\"%u\"} %u\n", in.name.c_str(), i, in.st.level_alerts[i]);
+	}
+    }
+
+    append(out, "# TYPE simtemp_level_alerts counter\n# HELP simtemp_level_alerts Alerts raised by each threshold level.\n");
+    for (const Instance &in : instances)
+    {
+	if (in.st.size < offsetof(struct simtemp_stats, level_alerts_total) + sizeof(in.st.level_alerts_total))
+	{
+	    continue;
+	}
+	for (uint32_t i = 0; in.up && i < in.st.nr_levels && i < SIMTEMP_MAX_LEVELS; i++)
+	{
+	    append(out, "simtemp_level_alerts_total{device=\"%s\",level=\"%u\"} %llu\n", in.name.c_str(), i,
+		   (unsigned long long)in.st.level_alerts_total[i]);
+	}
+    }
+
+    append(out, "# TYPE simtemp_exporter_collect_seconds gauge\n# HELP simtemp_exporter_collect_seconds Time to read every instance.\n"
+		"simtemp_exporter_collect_seconds %.9f\n# EOF\n", collect_ns / 1e9);
+}
+
+//One pass over every instance. Returns the time spent reading them.
+uint64_t collect_all(std::vector<Instance> &instances)
+{
+    uint64_t start = now_ns();
+
+    for (Instance &in : instances)
+    {
+	in.up = collect(in);
+    }
+
+    return now_ns() - start;
+}
+
+//----------------- HTTP (minimal): GET /metrics, one request per connection  --------------------//
+int listen_tcp(uint16_t port)
+{
+    struct sockaddr_in addr = {};
+    int one = 1;
+    int fd;
+
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+	return -1;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);     //Local socket only
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(fd, 16))
+    {
+	::close(fd);
+	return -1;
+    }
+
+    return fd;
+}
+
+int listen_unix(const char *path)
+{
+    struct sockaddr_un addr = {};
+    int fd;
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+	errno = ENAMETOOLONG;
+	return -1;
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+	return -1;
+    }
+
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(fd, 16))
+    {
+	::close(fd);
+	return -1;
+    }
+
+    return fd;
+}
+
+void write_all(int fd, const char *buf, size_t len)
+{
+    ssize_t n;
+
+    while (len)
+    {
+	n = write(fd, buf, len);
+	if (n < 0 && errno == EINTR)
+	{
+	    continue;
+	}
+	if (n <= 0)
+	{
+	    return;
+	}
+	buf += n;
+	len -= n;
+    }
+}
+
+void serve(int cfd, std::vector<Instance> &instances, std::string &body)
+{
+    struct pollfd pfd = { cfd, POLLIN, 0 };
+    char req[2048];
+    char hdr[256];
+    size_t len = 0;
+    ssize_t n;
+    int hlen;
+
+    //Request line and headers, 1 s at most
+    while (len < sizeof(req) - 1 && poll(&pfd, 1, 1000) > 0)
+    {
+	n = read(cfd, req + len, sizeof(req) - 1 - len);
+	if (n <= 0)
+	{
+	    break;
+	}
+	len += n;
+	req[len] = '\0';
+	if (strstr(req, "\r\n\r\n") || strstr(req, "\n\n"))
+	{
+	    break;
+	}
+    }
+    req[len] = '\0';
+
+    if (strncmp(req, "GET /metrics ", 13) && strncmp(req, "GET / ", 6))
+    {
+	static const char not_found[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+	write_all(cfd, not_found, sizeof(not_found) - 1);
+	return;
+    }
+
+    format(body, instances, collect_all(instances));
+
+    hlen = snprintf(hdr, sizeof(hdr),
+		    "HTTP/1.1 200 OK\r\nContent-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+		    "Content-Length: %zu\r\nConnection: close\r\n\r\n", body.size());
+    write_all(cfd, hdr, hlen);
+    write_all(cfd, body.data(), body.size());
+}
+
+void usage(const char *prog)
+{
+    fprintf(stderr,
+	    "usage: %s [-s sysfs_dir]... [-l port] [-u socket_path] [-o] [-B scrapes]\n"
+	    "  -s  instance directory (repeatable, default: every device bound to %s)\n"
+	    "  -l  TCP port on 127.0.0.1 (default %u)\n"
+	    "  -u  Unix socket instead of TCP\n"
+	    "  -o  print one scrape on stdout and exit\n"
+	    "  -B  benchmark: collect and format 'scrapes' times and print the cost of one\n",
+	    prog, DRIVER_DIR, DEFAULT_PORT);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::vector<Instance> instances;
+    std::vector<std::string> dirs;
+    std::string body;
+    const char *unix_path = nullptr;
+    uint16_t port = DEFAULT_PORT;
+    unsigned long bench = 0;
+    bool once = false;
+    struct sigaction sa = {};
+    time_t last_scan;
+    int lfd, cfd;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:l:u:oB:h")) != -1)
+    {
+	switch (opt)
+	{
+	case 's':
+	    dirs.push_back(optarg);
+	    break;
+	case 'l':
+	    port = (uint16_t)strtoul(optarg, nullptr, 10);
+	    break;
+	case 'u':
+	    unix_path = optarg;
+	    break;
+	case 'o':
+	    once = true;
+	    break;
+	case 'B':
+	    bench = strtoul(optarg, nullptr, 10);
+	    break;
+	default:
+	    usage(argv[0]);
+	    return 2;
+	}
+    }
+
+    body.reserve(16384);
+    discover(instances, dirs);
+    if (instances.empty())
+    {
+	fprintf(stderr, "simtemp_exporter: no instance found (is nxp_simtemp loaded?)\n");
+    }
+
+    if (once)
+    {
+	format(body, instances, collect_all(instances));
+	fwrite(body.data(), 1, body.size(), stdout);
+	return 0;
+    }
+
+    if (bench)
+    {
+	uint64_t collect_ns = 0, start = now_ns(), ns;
+
+	for (unsigned long i = 0; i < bench; i++)
+	{
+	    ns = collect_all(instances);
+	    format(body, instances, ns);
+	    collect_ns += ns;
+	}
+
+	printf("%zu instances (%s): collect %.2f us, collect + format %.2f us per scrape (%lu scrapes)\n",
+	       instances.size(), !instances.empty() && instances[0].bin_fd >= 0 ? "stats_bin" : "text",
+	       collect_ns / 1e3 / bench, (now_ns() - start) / 1e3 / bench, bench);
+	return 0;
+    }
+
+    lfd = unix_path ? listen_unix(unix_path) : listen_tcp(port);
+    if (lfd < 0)
+    {
+	perror(unix_path ? unix_path : "listen");
+	return 1;
+    }
+
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    signal(SIGPIPE, SIG_IGN);   //A scraper that closes early must not kill the exporter
+
+    fprintf(stderr, "simtemp_exporter: %zu instances, serving %s%s\n", instances.size(),
+	    unix_path ? unix_path : "http://127.0.0.1:", unix_path ? "" : std::to_string(port).c_str());
+
+    last_scan = time(nullptr);
+    while (!stop_requested)
+    {
+	cfd = accept4(lfd, nullptr, nullptr, SOCK_CLOEXEC);
+	if (cfd < 0)
+	{
+	    continue;   //EINTR from the signals
+	}
+
+	//Instances added or removed (nr_devices, DT overlays) are picked up between scrapes
+	if (time(nullptr) - last_scan >= RESCAN_S)
+	{
+	    discover(instances, dirs);
+	    last_scan = time(nullptr);
+	}
+
+	serve(cfd, instances, body);
+	::close(cfd);
+    }
+
+    ::close(lfd);
+    if (unix_path)
+    {
+	unlink(unix_path);
+    }
+    for (Instance &in : instances)
+    {
+	instance_close(in);
+    }
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+/***************************************************************************
+	Open Source License 2025 NXP Semiconductor Challenge Stage
+****************************************************************************
+* Title        : fanout_shm.h
+* Description  : Shared memory layout of the simtemp fan-out ring (daemon <-> subscribers)
+*
+* Environment  : C++17 (User Space)
+*
+* Responsible  : Daniel R Miranda [danielrmirandacortes@gmail.com]
+*
+* Guidelines   : Linux Kernel Coding Style
+*
+*
+* One writer (simtemp_fanoutd) and any number of readers. The ring is a broadcast ring:
+* the writer never waits for a reader, every reader keeps its own cursor and detects
+* when it was lapped (samples overwritten before it could read them).
+*
+*   header | subscriber table | record[capacity]
+*
+* Record n lives in record[n % capacity]. Its 'seq' works as a seqlock:
+*   2n + 1 while the writer fills it, 2n + 2 once it is published.
+* 'head' is the number of published records. 'notify' is a futex word incremented by
+* the writer after each batch; it only calls FUTEX_WAKE when 'waiters' is not zero.
+* Entries of the subscriber table whose pid no longer exists (crashed subscriber) are
+* released by the daemon.
+*
+****************************************************************************
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* * * * * * * * * * * Header Files *   *   *   *   *   *   *   *   *   *   *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _SIMTEMP_FANOUT_SHM_H_
+#define _SIMTEMP_FANOUT_SHM_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "../../kernel/nxp_simtemp_ioctl.h"     //struct simtemp_sample: the records carry the samples unchanged
+
+namespace simtemp
+{
+
+constexpr uint32_t FANOUT_MAGIC = 0x53544d46;   //"FMTS"
+constexpr uint32_t FANOUT_VERSION = 2;       //2: 'owner' in the header
+constexpr uint32_t FANOUT_MAX_SUBSCRIBERS = 64; //Entries of the subscriber table (monitoring only, no limit on readers)
+constexpr const char *FANOUT_DEFAULT_NAME = "/simtemp";  //shm_open() name
+
+//----------------- One published sample  --------------------//
+struct alignas(32) FanoutRecord
+{
+    std::atomic<uint64_t>   seq;        //Seqlock: 2n+1 writing, 2n+2 published (n = record number)
+    uint32_t                device;     //Index of the source in the daemon command line (0: first device)
+    uint32_t                reserved;
+    struct simtemp_sample   sample;     //Sample as read from /dev/simtemp
+};
+
+//----------------- Subscriber table: per-subscriber cursors  --------------------//
+//A subscriber claims one entry (pid != 0) and publishes its cursor there, so the daemon
+//can report the lag and the losses of every reader. Readers never write anything else.
+struct alignas(64) FanoutSubscriber
+{
+    std::atomic<int32_t>    pid;        //0: free entry
+    uint32_t                reserved;
+    std::atomic<uint64_t>   cursor;     //Next record this subscriber will read
+    std::atomic<uint64_t>   lost;       //Records overwritten before this subscriber read them
+};
+
+//----------------- Header (first cache lines of the mapping)  --------------------//
+struct FanoutHeader
+{
+    std::atomic<uint32_t>   magic;      //FANOUT_MAGIC, stored (release) once the daemon finished the initialization
+    uint32_t                version;
+    uint32_t                capacity;   //Records in the ring (power of two)
+    uint32_t                devices;    //Sources drained by the daemon
+    std::atomic<uint32_t>   alive;      //1 while the daemon runs
+    std::atomic<int32_t>    owner;      //pid of the daemon: a second daemon does not replace the ring of a live one
+
+    alignas(64) std::atomic<uint64_t> head;     //Published records (written by the daemon only)
+    alignas(64) std::atomic<uint32_t> notify;   //Futex word: incremented after each published batch
+    std::atomic<uint32_t>   waiters;            //Subscribers sleeping in FUTEX_WAIT
+
+    FanoutSubscriber        subscribers[FANOUT_MAX_SUBSCRIBERS];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "64-bit atomics are required in shared memory");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "32-bit atomics are required in shared memory");
+
+inline size_t fanout_shm_size(uint32_t capacity)
+{
+    return sizeof(FanoutHeader) + sizeof(FanoutRecord) * capacity;
+}
+
+inline FanoutRecord *fanout_records(FanoutHeader *hdr)
+{
+    return reinterpret_cast<FanoutRecord *>(hdr + 1);
+}
+
+} // namespace simtemp
+
+#endif // End of _SIMTEMP_FANOUT_SHM_H_
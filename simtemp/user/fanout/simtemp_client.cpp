@@ -0,0 +1,273 @@
+/***************************************************************************
+	Open Source License 2025 NXP Semiconductor Challenge Stage
+****************************************************************************
+* Title        : simtemp_client.cpp
+* Description  : Client library of the simtemp fan-out daemon (shared memory subscriber)
+*
+* Environment  : C++17 (User Space)
+*
+* Responsible  : Daniel R Miranda [danielrmirandacortes@gmail.com]
+*
+* Guidelines   : Linux Kernel Coding Style
+*
+****************************************************************************
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* * * * * * * * * * * Header Files *   *   *   *   *   *   *   *   *   *   *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "simtemp_client.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace simtemp
+{
+
+//FUTEX_WAIT on a shared mapping (no FUTEX_PRIVATE_FLAG: the daemon is another process)
+static int futex_wait(std::atomic<uint32_t> *word, uint32_t expected, const struct timespec *timeout)
+{
+    return syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT, expected, timeout, nullptr, 0);
+}
+
+Subscriber::~Subscriber()
+{
+    close();
+}
+
+int Subscriber::open(const char *name, bool from_oldest)
+{
+    struct stat st;
+    FanoutHeader *hdr;
+    uint64_t head;
+    uint32_t capacity;
+    int fd;
+    uint32_t i;
+
+    close();
+
+    fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+    {
+	return -errno;
+    }
+
+    //Size 0: created by the daemon but not initialized yet
+    if (fstat(fd, &st) || static_cast<size_t>(st.st_size) < sizeof(FanoutHeader))
+    {
+	::close(fd);
+	return -EAGAIN;
+    }
+
+    hdr = static_cast<FanoutHeader *>(mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    ::close(fd);
+    if (hdr == MAP_FAILED)
+    {
+	return -errno;
+    }
+
+    //Validation of the layout: written by the daemon before 'magic'
+    if (hdr->magic.load(std::memory_order_acquire) != FANOUT_MAGIC)
+    {
+	munmap(hdr, st.st_size);
+	return -EAGAIN;     //Created but not initialized yet
+    }
+
+    capacity = hdr->capacity;
+    if (hdr->version != FANOUT_VERSION || capacity == 0 ||
+	(capacity & (capacity - 1)) || fanout_shm_size(capacity) > static_cast<size_t>(st.st_size))
+    {
+	munmap(hdr, st.st_size);
+	return -EPROTO;
+    }
+
+    hdr_ = hdr;
+    rec_ = fanout_records(hdr);
+    size_ = st.st_size;
+    mask_ = capacity - 1;
+    lost_ = 0;
+
+    head = hdr->head.load(std::memory_order_acquire);
+    cursor_ = head;
+    if (from_oldest)
+    {
+	cursor_ = head > capacity ? head - capacity : 0;
+    }
+
+    //Per-subscriber cursor: one entry of the table, released by close()
+    for (i = 0; i < FANOUT_MAX_SUBSCRIBERS; i++)
+    {
+	int32_t free_pid = 0;
+
+	if (hdr->subscribers[i].pid.compare_exchange_strong(free_pid, getpid()))
+	{
+	    slot_ = &hdr->subscribers[i];
+	    publish_cursor();
+	    break;
+	}
+    }
+
+    return 0;
+}
+
+void Subscriber::close()
+{
+    if (!hdr_)
+    {
+	return;
+    }
+
+    if (slot_)
+    {
+	slot_->pid.store(0, std::memory_order_release);
+	slot_ = nullptr;
+    }
+
+    munmap(hdr_, size_);
+    hdr_ = nullptr;
+    rec_ = nullptr;
+}
+
+uint32_t Subscriber::devices() const
+{
+    return hdr_ ? hdr_->devices : 0;
+}
+
+void Subscriber::publish_cursor()
+{
+    if (slot_)
+    {
+	slot_->cursor.store(cursor_, std::memory_order_relaxed);
+	slot_->lost.store(lost_, std::memory_order_relaxed);
+    }
+}
+
+//Seqlock read of each record: the copy is valid only if 'seq' was 2n+2 before and after it.
+//Any other value means that the daemon lapped this subscriber: the record is counted as lost.
+size_t Subscriber::read(Sample *out, size_t max)
+{
+    size_t n = 0;
+
+    if (!hdr_)
+    {
+	return 0;
+    }
+
+    while (n < max)
+    {
+	uint64_t head = hdr_->head.load(std::memory_order_acquire);
+	uint64_t want;
+	uint64_t seq;
+
+	if (cursor_ >= head)
+	{
+	    break;
+	}
+
+	//Lapped by more than one ring: jump to the oldest record still present
+	if (head - cursor_ > mask_ + 1)
+	{
+	    lost_ += head - (mask_ + 1) - cursor_;
+	    cursor_ = head - (mask_ + 1);
+	}
+
+	FanoutRecord &rec = rec_[cursor_ & mask_];
+	want = 2 * cursor_ + 2;
+
+	seq = rec.seq.load(std::memory_order_acquire);
+	if (seq == want)
+	{
+	    out[n].device = rec.device;
+	    std::memcpy(&out[n].sample, &rec.sample, sizeof(out[n].sample));
+	    std::atomic_thread_fence(std::memory_order_acquire);
+	    seq = rec.seq.load(std::memory_order_relaxed);
+	}
+
+	if (seq == want)
+	{
+	    n++;
+	}
+	else
+	{
+	    lost_++;    //Overwritten before (or while) it was copied
+	}
+	cursor_++;
+    }
+
+    publish_cursor();
+
+    return n;
+}
+
+int Subscriber::wait(int timeout_ms)
+{
+    struct timespec deadline;
+    struct timespec now;
+    struct timespec rel;
+
+    if (!hdr_)
+    {
+	return -EBADF;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+	deadline.tv_sec++;
+	deadline.tv_nsec -= 1000000000L;
+    }
+
+    for (;;)
+    {
+	//'notify' is read before 'head': a batch published after this point changes it and FUTEX_WAIT returns at once
+	uint32_t seen = hdr_->notify.load(std::memory_order_acquire);
+	long ret;
+
+	if (hdr_->head.load(std::memory_order_acquire) > cursor_)
+	{
+	    return 1;
+	}
+	if (!hdr_->alive.load(std::memory_order_acquire))
+	{
+	    return -EPIPE;
+	}
+
+	if (timeout_ms >= 0)
+	{
+	    clock_gettime(CLOCK_MONOTONIC, &now);
+	    rel.tv_sec = deadline.tv_sec - now.tv_sec;
+	    rel.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+	    if (rel.tv_nsec < 0)
+	    {
+		rel.tv_sec--;
+		rel.tv_nsec += 1000000000L;
+	    }
+	    if (rel.tv_sec < 0)
+	    {
+		return 0;
+	    }
+	}
+
+	//The daemon only calls FUTEX_WAKE while somebody is registered here (seq_cst on both sides)
+	hdr_->waiters.fetch_add(1, std::memory_order_seq_cst);
+	ret = futex_wait(&hdr_->notify, seen, timeout_ms >= 0 ? &rel : nullptr);
+	hdr_->waiters.fetch_sub(1, std::memory_order_seq_cst);
+
+	if (ret < 0 && errno == EINTR)
+	{
+	    return -EINTR;
+	}
+    }
+}
+
+} // namespace simtemp
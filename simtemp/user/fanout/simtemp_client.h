@@ -0,0 +1,88 @@
+/***************************************************************************
+	Open Source License 2025 NXP Semiconductor Challenge Stage
+****************************************************************************
+* Title        : simtemp_client.h
+* Description  : Client library of the simtemp fan-out daemon (shared memory subscriber)
+*
+* Environment  : C++17 (User Space)
+*
+* Responsible  : Daniel R Miranda [danielrmirandacortes@gmail.com]
+*
+* Guidelines   : Linux Kernel Coding Style
+*
+*
+* Usage:
+*     simtemp::Subscriber sub;
+*     if (sub.open() < 0) ...                        //"/simtemp" published by simtemp_fanoutd
+*     simtemp::Sample s[64];
+*     while (sub.wait(1000) >= 0)
+*         for (size_t i = 0, n = sub.read(s, 64); i < n; i++) ...
+*
+* A subscriber never blocks the daemon nor the other subscribers: reading is a copy from
+* shared memory (no syscall) and waiting is one FUTEX_WAIT only when the ring is drained.
+* Errors are returned as negative errno values, as in the driver.
+*
+****************************************************************************
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* * * * * * * * * * * Header Files *   *   *   *   *   *   *   *   *   *   *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _SIMTEMP_CLIENT_H_
+#define _SIMTEMP_CLIENT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "fanout_shm.h"
+
+namespace simtemp
+{
+
+//One sample delivered to a subscriber
+struct Sample
+{
+    uint32_t                device;     //Source index in the daemon (0: first device)
+    struct simtemp_sample   sample;     //timestamp_ns, temp_mC and flags as produced by the driver
+};
+
+class Subscriber
+{
+public:
+    Subscriber() = default;
+    ~Subscriber();
+
+    Subscriber(const Subscriber &) = delete;
+    Subscriber &operator=(const Subscriber &) = delete;
+
+    //Maps the ring published by the daemon. from_oldest: starts at the oldest record still in the ring
+    //instead of the next one published. Returns 0 or -errno (-EPROTO: not a fan-out ring or other version,
+    //-EAGAIN: the daemon is still initializing it).
+    int open(const char *name = FANOUT_DEFAULT_NAME, bool from_oldest = false);
+    void close();
+
+    //Copies up to 'max' records without blocking. Returns the number of records copied.
+    size_t read(Sample *out, size_t max);
+
+    //Sleeps until a record is available. timeout_ms < 0 waits forever.
+    //Returns 1: records available, 0: timeout, -EINTR: signal, -EPIPE: the daemon exited.
+    int wait(int timeout_ms);
+
+    uint64_t lost() const { return lost_; }         //Records overwritten before this subscriber read them
+    uint64_t cursor() const { return cursor_; }     //Next record number to read
+    uint32_t devices() const;                       //Sources drained by the daemon
+
+private:
+    void publish_cursor();
+
+    FanoutHeader       *hdr_ = nullptr;
+    FanoutRecord       *rec_ = nullptr;
+    FanoutSubscriber   *slot_ = nullptr;    //Entry of the subscriber table (nullptr when the table is full)
+    size_t              size_ = 0;          //Size of the mapping
+    uint64_t            mask_ = 0;          //capacity - 1
+    uint64_t            cursor_ = 0;
+    uint64_t            lost_ = 0;
+};
+
+} // namespace simtemp
+
+#endif // End of _SIMTEMP_CLIENT_H_
@@ -0,0 +1,603 @@
+/***************************************************************************
+	Open Source License 2025 NXP Semiconductor Challenge Stage
+****************************************************************************
+* Title        : simtemp_fanoutd.cpp
+* Description  : Fan-out daemon: one kernel reader per device, any number of subscribers
+*
+* Environment  : C++17 (User Space)
+*
+* Responsible  : Daniel R Miranda [danielrmirandacortes@gmail.com]
+*
+* Guidelines   : Linux Kernel Coding Style
+*
+*
+* The daemon drains one or more /dev/simtemp devices with batched read() calls and
+* republishes every sample into a shared memory broadcast ring (fanout_shm.h).
+* Subscribers (simtemp_client.h) read it with their own cursor: one kernel reader and one
+* wakeup per batch, whatever the number of subscribers.
+*
+*   simtemp_fanoutd -d /dev/simtemp -d /dev/simtemp1       //driver instances
+*   simtemp_fanoutd -S 1000                                //synthetic 1 kHz source (no driver needed)
+*
+****************************************************************************
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* * * * * * * * * * * Header Files *   *   *   *   *   *   *   *   *   *   *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "fanout_shm.h"
+
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <linux/futex.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace
+{
+
+constexpr size_t READ_BATCH = 64;           //Samples requested per read() (the driver copies them in chunks of 8)
+constexpr uint32_t DEFAULT_CAPACITY = 4096; //Records in the ring: ~4 s of history at 1 kHz
+
+//One source of samples: a driver instance or the synthetic stand-in
+struct Source
+{
+    std::string     name;
+    int             fd = -1;
+    bool            synthetic = false;
+    uint64_t        reads = 0;      //read() calls that returned samples
+    uint64_t        samples = 0;    //Samples published from this source
+};
+
+volatile sig_atomic_t stop_requested;
+
+void on_signal(int)
+{
+    stop_requested = 1;
+}
+
+//----------------- Publisher: the only writer of the ring  --------------------//
+class Publisher
+{
+public:
+    int create(const char *name, uint32_t capacity, uint32_t devices, mode_t mode);
+    void destroy();
+    uint32_t reap();
+    void publish(uint32_t device, const struct simtemp_sample &sample);
+    void notify();
+    void report(FILE *out, double seconds);
+
+private:
+    std::string             name_;
+    simtemp::FanoutHeader  *hdr_ = nullptr;
+    simtemp::FanoutRecord  *rec_ = nullptr;
+    size_t                  size_ = 0;
+    uint64_t                mask_ = 0;
+    uint64_t                head_ = 0;      //Local copy of hdr_->head
+    uint64_t                last_head_ = 0; //head at the previous report
+    uint64_t                wakes_ = 0;     //FUTEX_WAKE calls
+};
+
+//pid of the daemon serving the ring 'name', or 0 when there is none (or it is a stale ring of a killed daemon)
+static pid_t ring_owner(const char *name)
+{
+    simtemp::FanoutHeader *hdr;
+    struct stat st;
+    pid_t owner = 0;
+    int fd;
+
+    fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+	return 0;
+    }
+
+    if (!fstat(fd, &st) && static_cast<size_t>(st.st_size) >= sizeof(*hdr))
+    {
+	void *mem = mmap(nullptr, sizeof(*hdr), PROT_READ, MAP_SHARED, fd, 0);
+
+	if (mem != MAP_FAILED)
+	{
+	    hdr = static_cast<simtemp::FanoutHeader *>(mem);
+	    if (hdr->magic.load(std::memory_order_acquire) == simtemp::FANOUT_MAGIC &&
+		hdr->version == simtemp::FANOUT_VERSION && hdr->alive.load(std::memory_order_acquire))
+	    {
+		owner = hdr->owner.load(std::memory_order_relaxed);
+	    }
+	    munmap(mem, sizeof(*hdr));
+	}
+    }
+    ::close(fd);
+
+    //EPERM: the process exists but belongs to another user
+    if (owner > 0 && owner != getpid() && (kill(owner, 0) == 0 || errno == EPERM))
+    {
+	return owner;
+    }
+
+    return 0;
+}
+
+int Publisher::create(const char *name, uint32_t capacity, uint32_t devices, mode_t mode)
+{
+    pid_t owner;
+    int fd;
+
+    name_ = name;
+    size_ = simtemp::fanout_shm_size(capacity);
+    mask_ = capacity - 1;
+
+    //The ring of a running daemon is never taken over: its subscribers would be orphaned
+    owner = ring_owner(name);
+    if (owner)
+    {
+	fprintf(stderr, "%s: served by simtemp_fanoutd pid %d\n", name, owner);
+	return -EBUSY;
+    }
+
+    //A ring left by a daemon that was killed is replaced: its subscribers see 'alive' == 0
+    shm_unlink(name);
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, mode);
+    if (fd < 0)
+    {
+	return -errno;
+    }
+    fchmod(fd, mode);   //Not masked by the umask: subscribers need write access to the subscriber table
+
+    if (ftruncate(fd, size_))
+    {
+	int err = -errno;
+
+	::close(fd);
+	shm_unlink(name);
+	return err;
+    }
+
+    void *mem = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED)
+    {
+	shm_unlink(name);
+	return -errno;
+    }
+
+    //ftruncate() zero-filled the object: every record has seq 0 (never published)
+    hdr_ = new (mem) simtemp::FanoutHeader();
+    rec_ = simtemp::fanout_records(hdr_);
+    hdr_->version = simtemp::FANOUT_VERSION;
+    hdr_->capacity = capacity;
+    hdr_->devices = devices;
+    hdr_->alive.store(1, std::memory_order_relaxed);
+    hdr_->owner.store(getpid(), std::memory_order_relaxed);
+    hdr_->magic.store(simtemp::FANOUT_MAGIC, std::memory_order_release);
+
+    return 0;
+}
+
+void Publisher::destroy()
+{
+    if (!hdr_)
+    {
+	return;
+    }
+
+    //Subscribers sleeping in wait() return -EPIPE
+    hdr_->alive.store(0, std::memory_order_release);
+    hdr_->notify.fetch_add(1, std::memory_order_seq_cst);
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&hdr_->notify), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+
+    munmap(hdr_, size_);
+    shm_unlink(name_.c_str());
+    hdr_ = nullptr;
+}
+
+//Releases the entries of the subscriber table whose process is gone (crashed without close()).
+//Only the pid is compared and cleared: a subscriber claiming the entry meanwhile is not disturbed. Returns the entries released.
+uint32_t Publisher::reap()
+{
+    uint32_t reaped = 0;
+    uint32_t i;
+
+    for (i = 0; i < simtemp::FANOUT_MAX_SUBSCRIBERS; i++)
+    {
+	simtemp::FanoutSubscriber &sub = hdr_->subscribers[i];
+	int32_t pid = sub.pid.load(std::memory_order_acquire);
+
+	if (pid > 0 && kill(pid, 0) && errno == ESRCH && sub.pid.compare_exchange_strong(pid, 0))
+	{
+	    fprintf(stderr, "subscriber pid=%d is gone, entry released\n", pid);
+	    reaped++;
+	}
+    }
+
+    return reaped;
+}
+
+//Seqlock write of record n: 2n+1 while it is filled, 2n+2 once published, then 'head' moves.
+//Nobody is notified here: notify() is called once per batch.
+void Publisher::publish(uint32_t device, const struct simtemp_sample &sample)
+{
+    simtemp::FanoutRecord &rec = rec_[head_ & mask_];
+
+    rec.seq.store(2 * head_ + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    rec.device = device;
+    std::memcpy(&rec.sample, &sample, sizeof(sample));
+
+    rec.seq.store(2 * head_ + 2, std::memory_order_release);
+    head_++;
+    hdr_->head.store(head_, std::memory_order_release);
+}
+
+//One futex word for every subscriber: FUTEX_WAKE only when somebody sleeps (seq_cst pairs with wait())
+void Publisher::notify()
+{
+    hdr_->notify.fetch_add(1, std::memory_order_seq_cst);
+
+    if (hdr_->waiters.load(std::memory_order_seq_cst))
+    {
+	syscall(SYS_futex, reinterpret_cast<uint32_t *>(&hdr_->notify), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+	wakes_++;
+    }
+}
+
+void Publisher::report(FILE *out, double seconds)
+{
+    uint32_t i;
+
+    fprintf(out, "published=%llu rate=%.0f/s futex_wakes=%llu\n", (unsigned long long)head_,
+	    (head_ - last_head_) / seconds, (unsigned long long)wakes_);
+    last_head_ = head_;
+
+    for (i = 0; i < simtemp::FANOUT_MAX_SUBSCRIBERS; i++)
+    {
+	const simtemp::FanoutSubscriber &sub = hdr_->subscribers[i];
+	int32_t pid = sub.pid.load(std::memory_order_acquire);
+
+	if (pid)
+	{
+	    fprintf(out, "  subscriber pid=%d lag=%llu lost=%llu\n", pid,
+		    (unsigned long long)(head_ - sub.cursor.load(std::memory_order_relaxed)),
+		    (unsigned long long)sub.lost.load(std::memory_order_relaxed));
+	}
+    }
+    fflush(out);
+}
+
+//----------------- Sources  --------------------//
+
+//Driver instance: non blocking, and broadcast delivery so the daemon does not take samples from other readers
+int open_device(Source &src)
+{
+    __u32 delivery = SIMTEMP_DELIVERY_BROADCAST;
+
+    src.fd = open(src.name.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (src.fd < 0)
+    {
+	return -errno;
+    }
+
+    if (ioctl(src.fd, SIMTEMP_IOC_SET_DELIVERY, &delivery))
+    {
+	fprintf(stderr, "%s: broadcast delivery not supported (%s), sharing the queue\n", src.name.c_str(), strerror(errno));
+    }
+
+    return 0;
+}
+
+//Synthetic stand-in: a periodic timerfd producing samples like the driver (45 C +/- 5 C, threshold 45 C)
+int open_synthetic(Source &src, unsigned int rate_hz)
+{
+    struct itimerspec its = {};
+    long period_ns = 1000000000L / rate_hz;
+
+    src.name = "synthetic";
+    src.synthetic = true;
+    src.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (src.fd < 0)
+    {
+	return -errno;
+    }
+
+    its.it_interval.tv_sec = period_ns / 1000000000L;
+    its.it_interval.tv_nsec = period_ns % 1000000000L;
+    its.it_value = its.it_interval;
+
+    return timerfd_settime(src.fd, 0, &its, nullptr) ? -errno : 0;
+}
+
+//Drains one source completely. Returns the samples published, or -errno when the source must be dropped.
+long drain(Source &src, uint32_t index, Publisher &pub, std::minstd_rand &rng)
+{
+    struct simtemp_sample batch[READ_BATCH];
+    struct timespec ts;
+    long published = 0;
+    uint64_t expirations;
+    ssize_t n;
+    size_t i;
+
+    if (src.synthetic)
+    {
+	if (read(src.fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+	{
+	    return errno == EAGAIN ? 0 : -errno;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	for (i = 0; i < expirations; i++)
+	{
+	    struct simtemp_sample s;
+
+	    s.timestamp_ns = ts.tv_sec * 1000000000ULL + ts.tv_nsec + i;   //Strictly increasing inside the batch
+	    s.temp_mC = 40000 + static_cast<int32_t>(rng() % 10000);
+	    s.flags = SAMPLE_AVAILABLE | (s.temp_mC > 45000 ? (TRESHOLD_CROSSED | SIMTEMP_LEVEL_FLAG(0)) : 0);
+	    pub.publish(index, s);
+	}
+	src.reads++;
+	src.samples += expirations;
+
+	return expirations;
+    }
+
+    for (;;)
+    {
+	n = read(src.fd, batch, sizeof(batch));
+	if (n < 0)
+	{
+	    return (errno == EAGAIN || errno == EINTR) ? published : -errno;
+	}
+	if (n == 0)
+	{
+	    return -ENODEV;
+	}
+
+	for (i = 0; i < n / sizeof(batch[0]); i++)
+	{
+	    pub.publish(index, batch[i]);
+	}
+	src.reads++;
+	src.samples += n / sizeof(batch[0]);
+	published += n / sizeof(batch[0]);
+
+	//Short read: the queue of the driver is drained
+	if (static_cast<size_t>(n) < sizeof(batch))
+	{
+	    return published;
+	}
+    }
+}
+
+void usage(const char *prog)
+{
+    fprintf(stderr,
+	    "usage: %s [-d device]... [-S rate_hz] [-n shm_name] [-c capacity] [-m mode] [-i stats_s]\n"
+	    "  -d  device to drain (repeatable, default /dev/simtemp)\n"
+	    "  -S  synthetic source at rate_hz instead of (or besides) the devices\n"
+	    "  -n  shared memory name (default %s)\n"
+	    "  -c  ring capacity in records, power of two (default %u)\n"
+	    "  -m  permissions of the shared memory (default 0660)\n"
+	    "  -i  print statistics every stats_s seconds (default 0: never)\n",
+	    prog, simtemp::FANOUT_DEFAULT_NAME, DEFAULT_CAPACITY);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::vector<Source> sources;
+    std::vector<std::string> devices;
+    const char *shm_name = simtemp::FANOUT_DEFAULT_NAME;
+    uint32_t capacity = DEFAULT_CAPACITY;
+    unsigned int synthetic_hz = 0;
+    unsigned int stats_s = 0;
+    mode_t mode = 0660;
+    struct epoll_event ev[8];
+    struct sigaction sa = {};
+    struct timespec last, now, last_reap;
+    std::minstd_rand rng(getpid());
+    Publisher pub;
+    size_t live;    //Sources not dropped yet
+    int epfd;
+    int opt;
+    int ret;
+
+    while ((opt = getopt(argc, argv, "d:S:n:c:m:i:h")) != -1)
+    {
+	switch (opt)
+	{
+	case 'd':
+	    devices.push_back(optarg);
+	    break;
+	case 'S':
+	    synthetic_hz = strtoul(optarg, nullptr, 10);
+	    break;
+	case 'n':
+	    shm_name = optarg;
+	    break;
+	case 'c':
+	    capacity = strtoul(optarg, nullptr, 0);
+	    break;
+	case 'm':
+	    mode = strtoul(optarg, nullptr, 8);
+	    break;
+	case 'i':
+	    stats_s = strtoul(optarg, nullptr, 10);
+	    break;
+	default:
+	    usage(argv[0]);
+	    return 2;
+	}
+    }
+
+    if (capacity < 2 || (capacity & (capacity - 1)) || synthetic_hz > 1000000)
+    {
+	usage(argv[0]);
+	return 2;
+    }
+    if (devices.empty() && !synthetic_hz)
+    {
+	devices.push_back("/dev/simtemp");
+    }
+
+    //-------Sources-------
+    for (const std::string &name : devices)
+    {
+	Source src;
+
+	src.name = name;
+	ret = open_device(src);
+	if (ret)
+	{
+	    fprintf(stderr, "%s: %s\n", name.c_str(), strerror(-ret));
+	    return 1;
+	}
+	sources.push_back(src);
+    }
+    if (synthetic_hz)
+    {
+	Source src;
+
+	ret = open_synthetic(src, synthetic_hz);
+	if (ret)
+	{
+	    fprintf(stderr, "synthetic source: %s\n", strerror(-ret));
+	    return 1;
+	}
+	sources.push_back(src);
+    }
+
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0)
+    {
+	perror("epoll_create1");
+	return 1;
+    }
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+	struct epoll_event e = {};
+
+	e.events = EPOLLIN;
+	e.data.u32 = i;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, sources[i].fd, &e))
+	{
+	    perror("epoll_ctl");
+	    return 1;
+	}
+    }
+
+    //-------Shared memory ring-------
+    ret = pub.create(shm_name, capacity, sources.size(), mode);
+    if (ret)
+    {
+	fprintf(stderr, "%s: %s\n", shm_name, strerror(-ret));
+	return 1;
+    }
+
+    //No SA_RESTART: epoll_wait() returns EINTR and the loop ends
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    fprintf(stderr, "simtemp_fanoutd: %zu source(s) -> %s (%u records)\n", sources.size(), shm_name, capacity);
+    clock_gettime(CLOCK_MONOTONIC, &last);
+    last_reap = last;
+    live = sources.size();
+    ret = 0;
+
+    //-------Main loop: one wakeup drains every ready source, one notify per batch-------
+    while (!stop_requested)
+    {
+	//Woken at least once per second: entries of crashed subscribers are released even without samples
+	int n = epoll_wait(epfd, ev, 8, 1000);
+	long published = 0;
+
+	if (n < 0 && errno != EINTR)
+	{
+	    perror("epoll_wait");
+	    break;
+	}
+
+	for (int i = 0; i < n; i++)
+	{
+	    uint32_t index = ev[i].data.u32;
+	    long got = drain(sources[index], index, pub, rng);
+
+	    if (got < 0)
+	    {
+		fprintf(stderr, "%s: %s, source dropped\n", sources[index].name.c_str(), strerror(-got));
+		epoll_ctl(epfd, EPOLL_CTL_DEL, sources[index].fd, nullptr);
+		close(sources[index].fd);
+		sources[index].fd = -1;
+		live--;
+		continue;
+	    }
+	    published += got;
+	}
+
+	if (published)
+	{
+	    pub.notify();
+	}
+
+	//Every source dropped: nothing will ever be published, the subscribers are told (alive = 0)
+	if (!live)
+	{
+	    fprintf(stderr, "simtemp_fanoutd: no source left, exiting\n");
+	    ret = 1;
+	    break;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (now.tv_sec - last_reap.tv_sec >= 1)
+	{
+	    pub.reap();
+	    last_reap = now;
+	}
+
+	if (stats_s)
+	{
+	    double elapsed = (now.tv_sec - last.tv_sec) + (now.tv_nsec - last.tv_nsec) / 1e9;
+
+	    if (elapsed >= stats_s)
+	    {
+		pub.report(stdout, elapsed);
+		for (const Source &src : sources)
+		{
+		    printf("  source %s reads=%llu samples=%llu samples/read=%.1f\n", src.name.c_str(),
+			   (unsigned long long)src.reads, (unsigned long long)src.samples,
+			   src.reads ? (double)src.samples / src.reads : 0.0);
+		}
+		last = now;
+	    }
+	}
+    }
+
+    pub.destroy();
+    for (const Source &src : sources)
+    {
+	if (src.fd >= 0)
+	{
+	    close(src.fd);
+	}
+    }
+    close(epfd);
+
+    return ret;
+}
@@ -0,0 +1,163 @@
+/***************************************************************************
+	Open Source License 2025 NXP Semiconductor Challenge Stage
+****************************************************************************
+* Title        : simtemp_sub.cpp
+* Description  : Example subscriber of the fan-out daemon, also used by 'make check'
+*
+* Environment  : C++17 (User Space)
+*
+* Responsible  : Daniel R Miranda [danielrmirandacortes@gmail.com]
+*
+* Guidelines   : Linux Kernel Coding Style
+*
+*
+*   simtemp_sub                 //prints every sample like main.py
+*   simtemp_sub -q -t 5 -x      //5 s quiet run, exit 1 on lost or out-of-order samples
+*
+****************************************************************************
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* * * * * * * * * * * Header Files *   *   *   *   *   *   *   *   *   *   *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "simtemp_client.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#include <unistd.h>
+
+namespace
+{
+
+volatile sig_atomic_t stop_requested;
+
+void on_signal(int)
+{
+    stop_requested = 1;
+}
+
+double monotonic_s()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const char *name = simtemp::FANOUT_DEFAULT_NAME;
+    simtemp::Subscriber sub;
+    simtemp::Sample batch[256];
+    std::vector<uint64_t> last_ts;      //Last timestamp of each device (order check)
+    struct sigaction sa = {};
+    unsigned long long received = 0;
+    unsigned long long disorder = 0;
+    double duration = 0;
+    double start;
+    bool quiet = false;
+    bool check = false;
+    bool oldest = false;
+    int opt;
+    int ret;
+
+    while ((opt = getopt(argc, argv, "n:t:qxo")) != -1)
+    {
+	switch (opt)
+	{
+	case 'n':
+	    name = optarg;
+	    break;
+	case 't':
+	    duration = atof(optarg);
+	    break;
+	case 'q':
+	    quiet = true;
+	    break;
+	case 'x':
+	    check = true;
+	    break;
+	case 'o':
+	    oldest = true;
+	    break;
+	default:
+	    fprintf(stderr, "usage: %s [-n shm_name] [-t seconds] [-q] [-x] [-o]\n", argv[0]);
+	    return 2;
+	}
+    }
+
+    //The daemon may still be initializing the ring
+    for (int retry = 0; (ret = sub.open(name, oldest)) == -EAGAIN && retry < 50; retry++)
+    {
+	usleep(20000);
+    }
+    if (ret)
+    {
+	fprintf(stderr, "%s: %s\n", name, strerror(-ret));
+	return 1;
+    }
+
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    last_ts.assign(sub.devices() + 1, 0);
+    start = monotonic_s();
+
+    while (!stop_requested)
+    {
+	double left = duration - (monotonic_s() - start);
+
+	if (duration > 0 && left <= 0)
+	{
+	    break;
+	}
+
+	ret = sub.wait(duration > 0 ? static_cast<int>(left * 1000) + 1 : -1);
+	if (ret < 0)
+	{
+	    if (ret != -EINTR)
+	    {
+		fprintf(stderr, "wait: %s\n", strerror(-ret));
+	    }
+	    break;
+	}
+
+	for (size_t i = 0, n = sub.read(batch, 256); i < n; i++)
+	{
+	    const simtemp::Sample &s = batch[i];
+
+	    if (s.device < last_ts.size())
+	    {
+		disorder += s.sample.timestamp_ns <= last_ts[s.device];
+		last_ts[s.device] = s.sample.timestamp_ns;
+	    }
+	    received++;
+
+	    if (!quiet)
+	    {
+		printf("dev=%u ts=%llu temp=%.1fC alert=%d levels=%#x\n", s.device,
+		       (unsigned long long)s.sample.timestamp_ns, s.sample.temp_mC / 1000.0,
+		       !!(s.sample.flags & TRESHOLD_CROSSED), SIMTEMP_LEVEL_FLAGS(s.sample.flags));
+	    }
+	}
+    }
+
+    printf("received=%llu lost=%llu out_of_order=%llu rate=%.0f/s\n", received,
+	   (unsigned long long)sub.lost(), disorder, received / (monotonic_s() - start));
+
+    if (check && (sub.lost() || disorder || !received))
+    {
+	return 1;
+    }
+
+    return 0;
+}